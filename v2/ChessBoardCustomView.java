@@ -26,6 +26,14 @@ public class ChessBoardCustomView extends View {
     private float animationProgress = 0f;
     private ValueAnimator pulseAnimator;
 
+    // The pieces and legal moves as of boardVersion, refreshed only when
+    // the position has moved on, so animation frames and taps do not go
+    // back to native code for them. Moves are packed as from * 64 + to.
+    private final int[] board = new int[64];
+    private int[] legalMoves = new int[0];
+    private int boardVersion = -1;
+    private final Paint paint = new Paint();
+
     private static final String[] PIECE_UNICODE = {
             "",     // 0
             "♙",    // 1
@@ -133,9 +141,39 @@ public class ChessBoardCustomView extends View {
         selectedRow = -1;
         selectedCol = -1;
         highlightedMoves = new int[0];
+        boardVersion = -1;
         invalidate();
     }
 
+    private void syncBoard() {
+        if (activity.getPositionVersion() != boardVersion) {
+            boardVersion = activity.getBoardSnapshot(board);
+            int[] moves = activity.getAllLegalMoves();
+            legalMoves = (moves != null) ? moves : new int[0];
+        }
+    }
+
+    // Target squares of the selected piece as row, col pairs
+    private int[] movesFrom(int row, int col) {
+        int from = row * 8 + col;
+        int count = 0;
+        for (int move : legalMoves) {
+            if (move / 64 == from) count++;
+        }
+        int[] targets = new int[2 * count];
+        int i = 0;
+        for (int move : legalMoves) {
+            if (move / 64 != from) continue;
+            targets[i++] = (move % 64) / 8;
+            targets[i++] = move % 8;
+        }
+        return targets;
+    }
+
+    private int pieceAt(int row, int col) {
+        return board[row * 8 + col];
+    }
+
     private void handleTouch(float x, float y) {
         if (activity == null) return;
 
@@ -149,7 +187,8 @@ public class ChessBoardCustomView extends View {
 
         if (row < 0 || row >= 8 || col < 0 || col >= 8) return;
 
-        if (activity.isGameOver()) {
+        syncBoard();
+        if (legalMoves.length == 0) {
             Toast.makeText(getContext(), "Game is over! Start a new game.", Toast.LENGTH_SHORT).show();
             return;
         }
@@ -159,14 +198,14 @@ public class ChessBoardCustomView extends View {
         }
 
         int currentPlayer = activity.getCurrentPlayer();
-        int piece = activity.getPiece(row, col);
+        int piece = pieceAt(row, col);
         int pieceColor = (piece == 0) ? 0 : (piece / 10);
 
         if (selectedRow == -1) {
             if (piece != 0 && pieceColor == currentPlayer) {
                 selectedRow = row;
                 selectedCol = col;
-                highlightedMoves = activity.getLegalMoves(row, col);
+                highlightedMoves = movesFrom(row, col);
                 if (!pulseAnimator.isRunning()) { // <-- START ANIMATION
                     pulseAnimator.start();
                 }
@@ -195,7 +234,7 @@ public class ChessBoardCustomView extends View {
             } else if (piece != 0 && pieceColor == currentPlayer) {
                 selectedRow = row;
                 selectedCol = col;
-                highlightedMoves = activity.getLegalMoves(row, col);
+                highlightedMoves = movesFrom(row, col);
                 if (!pulseAnimator.isRunning()) { // <-- START ANIMATION (for re-selection)
                     pulseAnimator.start();
                 }
@@ -223,7 +262,8 @@ public class ChessBoardCustomView extends View {
         int offsetX = (getWidth() - boardSize) / 2;
         int offsetY = (getHeight() - boardSize) / 2;
 
-        Paint paint = new Paint();
+        syncBoard();
+        paint.reset();
         paint.setAntiAlias(true);
 
         // Draw coordinates
@@ -253,7 +293,7 @@ public class ChessBoardCustomView extends View {
                 paint.setAlpha(255);
 
                 // Draw piece
-                int piece = activity.getPiece(row, col);
+                int piece = pieceAt(row, col);
                 if (piece > 0 && piece < PIECE_UNICODE.length) {
                     int colorCode = (piece == 0) ? 0 : (piece / 10);
 
@@ -292,7 +332,7 @@ public class ChessBoardCustomView extends View {
             int x = offsetX + col * squareSize;
             int y = offsetY + row * squareSize;
 
-            int targetPiece = activity.getPiece(row, col);
+            int targetPiece = pieceAt(row, col);
             if (targetPiece != 0) {
                 // Draw ring for capture
                 paint.setStyle(Paint.Style.STROKE);
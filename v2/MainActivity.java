@@ -1,9 +1,19 @@
 package elrasseo.syreao.checkmate;
 
 import android.app.Activity;
+import android.app.ActivityManager;
 import android.content.Intent;
 import android.content.SharedPreferences;
+import android.content.pm.PackageManager;
+import android.os.BatteryManager;
 import android.os.Bundle;
+import android.os.PowerManager;
+import android.util.Log;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
 import android.view.View;
 import android.widget.Button;
 import android.widget.ImageButton;
@@ -23,13 +33,29 @@ public class MainActivity extends Activity {
 
     public native void initGame();
     public native void setDifficulty(int difficulty);
+    public native void setHashSize(int megabytes);
+    public native void setThreads(int threads);
+    public native boolean loadNetwork(String path);
+    public native void setUseNetwork(boolean enabled);
+    public native boolean loadBook(String path);
+    public native boolean setTablebases(String path, int pieceLimit);
     public native void cleanupGame();
     public native int getPiece(int row, int col);
+    public native int getBoardSnapshot(int[] board);
+    public native int getPositionVersion();
     public native int[] getLegalMoves(int row, int col);
+    public native int[] getAllLegalMoves();
     public native boolean makeMove(int fromRow, int fromCol, int toRow, int toCol);
     public native int[] getComputerMove();
+    public native boolean startSearch();
+    public native void stopSearch();
+    public native int[] pollComputerMove();
+    public native boolean startPondering();
+    public native void stopPondering();
     public native int getCurrentPlayer();
     public native boolean isGameOver();
+    public native int getGameStatus();
+    public native String getSearchInfo();
 
     private ChessBoardCustomView chessBoardCustomView;
     private TextView statusText;
@@ -46,8 +72,23 @@ public class MainActivity extends Activity {
     private Handler handler = new Handler();
     private SharedPreferences prefs;
 
+    // getGameStatus results
+    private static final int GAME_CHECKMATE = 1;
+    private static final int GAME_STALEMATE = 2;
+
     private static final int REQUEST_SETTINGS = 1;
     private static final int REQUEST_ONLINE = 2;
+    private static final int SEARCH_POLL_MS = 50;
+    private static final String SEARCH_LOG_TAG = "ChessSearch";
+    private static final String NETWORK_ASSET = "checkmate.nnue";
+    private static final String BOOK_ASSET = "book.bin";
+    private static final String TABLEBASE_ASSETS = "tablebases";
+    // All the engine indexes; probing goes as far as the shipped tables
+    private static final int TABLEBASE_PIECES = 5;
+    // Below this charge pondering waits for the charger
+    private static final int PONDER_MIN_BATTERY = 30;
+
+    private final Runnable pollComputerMove = this::collectComputerMove;
 
     @Override
     protected void onCreate(Bundle savedInstanceState) {
@@ -68,11 +109,92 @@ public class MainActivity extends Activity {
         difficultyGroup = binding.difficultyGroup;
 
         chessBoardCustomView.setActivity(this);
+        configureEngine();
         loadSettings();
         setupListeners();
         newGame();
     }
 
+    // The search table is native memory; keep it small where RAM is tight.
+    // Low-end devices also get fewer search threads to stay cool.
+    private void configureEngine() {
+        ActivityManager activityManager = (ActivityManager) getSystemService(ACTIVITY_SERVICE);
+        setThreads(activityManager.isLowRamDevice() ? 2 : 0);
+        if (activityManager.isLowRamDevice()) {
+            setHashSize(4);
+        } else if (activityManager.getMemoryClass() >= 256) {
+            setHashSize(64);
+        } else {
+            setHashSize(16);
+        }
+        loadBundledData();
+    }
+
+    // The engine maps its evaluation network, opening book and endgame
+    // tables from files, so the ones shipped in the assets are copied out
+    // once per install or update. Without a network the engine evaluates
+    // with its piece-square tables; without a book or tables it searches
+    // every move.
+    private void loadBundledData() {
+        long installed;
+        try {
+            installed = getPackageManager().getPackageInfo(getPackageName(), 0).lastUpdateTime;
+        } catch (PackageManager.NameNotFoundException e) {
+            installed = Long.MAX_VALUE;
+        }
+
+        File network = copyAsset(NETWORK_ASSET, installed);
+        if (network != null) {
+            loadNetwork(network.getAbsolutePath());
+        }
+        File book = copyAsset(BOOK_ASSET, installed);
+        if (book != null) {
+            loadBook(book.getAbsolutePath());
+        }
+
+        String[] tables;
+        try {
+            tables = getAssets().list(TABLEBASE_ASSETS);
+        } catch (IOException e) {
+            tables = null;
+        }
+        if (tables != null && tables.length > 0) {
+            new File(getFilesDir(), TABLEBASE_ASSETS).mkdirs();
+            for (String table : tables) {
+                copyAsset(TABLEBASE_ASSETS + "/" + table, installed);
+            }
+            setTablebases(new File(getFilesDir(), TABLEBASE_ASSETS).getAbsolutePath(), TABLEBASE_PIECES);
+        }
+    }
+
+    // The asset's copy in the app's files, or null when it is not bundled.
+    // A copy older than the installed APK may be from a previous version and
+    // is replaced; the new one is written aside and renamed into place, so
+    // an interrupted copy is never mistaken for a finished one.
+    private File copyAsset(String name, long installed) {
+        File file = new File(getFilesDir(), name);
+        if (file.exists() && file.lastModified() >= installed) {
+            return file;
+        }
+        File partial = new File(getFilesDir(), name + ".part");
+        try (InputStream in = getAssets().open(name);
+             OutputStream out = new FileOutputStream(partial)) {
+            byte[] buffer = new byte[64 * 1024];
+            int read;
+            while ((read = in.read(buffer)) > 0) {
+                out.write(buffer, 0, read);
+            }
+        } catch (IOException e) {
+            partial.delete();
+            return null;
+        }
+        if (!partial.renameTo(file)) {
+            partial.delete();
+            return null;
+        }
+        return file;
+    }
+
     private void loadSettings() {
         aiDifficulty = prefs.getInt("difficulty", 2);
         String theme = prefs.getString("theme", "classic");
@@ -138,6 +260,7 @@ public class MainActivity extends Activity {
     }
 
     private void newGame() {
+        handler.removeCallbacksAndMessages(null);
         initGame();
         setDifficulty(aiDifficulty);
         chessBoardCustomView.reset();
@@ -149,10 +272,14 @@ public class MainActivity extends Activity {
         int currentPlayer = getCurrentPlayer();
         String playerName = (currentPlayer == 1) ? "White" : "Black";
 
-        if (isGameOver()) {
+        int status = getGameStatus();
+        if (status == GAME_CHECKMATE) {
             String winner = ((currentPlayer == 1) ? "Black" : "White");
             statusText.setText("🏆 Game Over! " + winner + " Wins!");
             statusText.setTextColor(Color.parseColor("#FFD700"));
+        } else if (status == GAME_STALEMATE) {
+            statusText.setText("🤝 Stalemate! It's a draw.");
+            statusText.setTextColor(Color.parseColor("#FFD700"));
         } else {
             if (isOnlineMode) {
                 statusText.setText("🌐 " + playerName + "'s Turn (Online)");
@@ -161,23 +288,57 @@ public class MainActivity extends Activity {
             }
             statusText.setTextColor(Color.parseColor("#00d4ff"));
 
-            if (isVsComputer && currentPlayer == 2 && !isGameOver()) {
+            if (isVsComputer && currentPlayer == 2) {
                 statusText.setText("🤖 Computer is thinking...");
                 handler.postDelayed(() -> makeComputerMove(), 500);
             }
         }
     }
 
+    // The search runs on a native thread; poll for its move instead of
+    // blocking the UI thread until it is done
     private void makeComputerMove() {
-        int[] move = getComputerMove();
+        if (startSearch()) {
+            handler.postDelayed(pollComputerMove, SEARCH_POLL_MS);
+        }
+    }
+
+    private void collectComputerMove() {
+        int[] move = pollComputerMove();
+        if (move == null) {
+            handler.postDelayed(pollComputerMove, SEARCH_POLL_MS);
+            return;
+        }
+        String info = getSearchInfo();
+        if (info != null) {
+            Log.d(SEARCH_LOG_TAG, info);
+        }
         if (move.length == 4 && move[0] >= 0) {
             makeMove(move[0], move[1], move[2], move[3]);
             updateMoveHistory(move[0], move[1], move[2], move[3]);
             chessBoardCustomView.invalidate();
             updateStatus();
+            if (isVsComputer && !isGameOver() && ponderAllowed()) {
+                startPondering();
+            }
         }
     }
 
+    // Pondering keeps a core busy while the player thinks: only when the
+    // player opted in, battery saver is off and the battery is charging or
+    // not running low
+    private boolean ponderAllowed() {
+        if (!prefs.getBoolean("ponder", false)) return false;
+
+        PowerManager powerManager = (PowerManager) getSystemService(POWER_SERVICE);
+        if (powerManager != null && powerManager.isPowerSaveMode()) return false;
+
+        BatteryManager batteryManager = (BatteryManager) getSystemService(BATTERY_SERVICE);
+        if (batteryManager == null) return true;
+        return batteryManager.isCharging() ||
+                batteryManager.getIntProperty(BatteryManager.BATTERY_PROPERTY_CAPACITY) >= PONDER_MIN_BATTERY;
+    }
+
     private void updateMoveHistory(int fromRow, int fromCol, int toRow, int toCol) {
         String moveNotation = convertToChessNotation(fromRow, fromCol, toRow, toCol);
         String currentText = moveHistoryText.getText().toString();
@@ -199,9 +360,16 @@ public class MainActivity extends Activity {
     public boolean isOnlineMode() {
         return isOnlineMode;
     }
+    @Override
+    protected void onPause() {
+        super.onPause();
+        stopPondering();
+    }
+
     @Override
     protected void onDestroy() {
         super.onDestroy();
+        handler.removeCallbacksAndMessages(null);
         cleanupGame();
     }
 
@@ -210,6 +378,7 @@ public class MainActivity extends Activity {
         super.onActivityResult(requestCode, resultCode, data);
         if (requestCode == REQUEST_SETTINGS && resultCode == RESULT_OK) {
             loadSettings();
+            if (!ponderAllowed()) stopPondering();
             chessBoardCustomView.invalidate();
         } else if (requestCode == REQUEST_ONLINE) {
             if (resultCode == RESULT_OK) {
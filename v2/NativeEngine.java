@@ -0,0 +1,79 @@
+package elrasseo.syreao.checkmate;
+
+/**
+ * One game hosted by the native engine, independent of MainActivity's and of
+ * every other instance: its own board, search table and search thread. Each
+ * instance may be driven from its own thread; close it when the game ends so
+ * the native side can reuse it.
+ */
+public class NativeEngine implements AutoCloseable {
+    static {
+        System.loadLibrary("checkmate");
+    }
+
+    public static final int GAME_ONGOING = 0;
+    public static final int GAME_CHECKMATE = 1;
+    public static final int GAME_STALEMATE = 2;
+
+    private long handle;
+
+    public NativeEngine() {
+        handle = createGame();
+        if (handle == 0) {
+            throw new IllegalStateException("No more native games can be hosted");
+        }
+    }
+
+    public void newGame() { newGame(handle); }
+    public void setDifficulty(int difficulty) { setDifficulty(handle, difficulty); }
+    public boolean makeMove(int fromRow, int fromCol, int toRow, int toCol) {
+        return makeMove(handle, fromRow, fromCol, toRow, toCol);
+    }
+    public int getBoardSnapshot(int[] board) { return getBoardSnapshot(handle, board); }
+    public int getPositionVersion() { return getPositionVersion(handle); }
+    public int[] getLegalMoves(int row, int col) { return getLegalMoves(handle, row, col); }
+    public int[] getAllLegalMoves() { return getAllLegalMoves(handle); }
+    public int getGameStatus() { return getGameStatus(handle); }
+    public int getCurrentPlayer() { return getCurrentPlayer(handle); }
+    public boolean startSearch() { return startSearch(handle); }
+    public int[] pollComputerMove() { return pollComputerMove(handle); }
+    public void stopSearch() { stopSearch(handle); }
+    public int[] getComputerMove() { return getComputerMove(handle); }
+    public String getSearchInfo() { return getSearchInfo(handle); }
+
+    /**
+     * Runs the search benchmark, the same as the host bench tool, and returns
+     * its summary line; the signature matches the host's for the same depth
+     * and evaluator. Takes seconds, so call it off the UI thread. A depth of
+     * zero picks the default.
+     */
+    public static String runBench(int depth, boolean withNetwork) {
+        return bench(depth, withNetwork);
+    }
+
+    @Override
+    public synchronized void close() {
+        if (handle != 0) {
+            destroyGame(handle);
+            handle = 0;
+        }
+    }
+
+    private static native long createGame();
+    private static native void destroyGame(long handle);
+    private static native void newGame(long handle);
+    private static native void setDifficulty(long handle, int difficulty);
+    private static native boolean makeMove(long handle, int fromRow, int fromCol, int toRow, int toCol);
+    private static native int getBoardSnapshot(long handle, int[] board);
+    private static native int getPositionVersion(long handle);
+    private static native int[] getLegalMoves(long handle, int row, int col);
+    private static native int[] getAllLegalMoves(long handle);
+    private static native int getGameStatus(long handle);
+    private static native int getCurrentPlayer(long handle);
+    private static native boolean startSearch(long handle);
+    private static native int[] pollComputerMove(long handle);
+    private static native void stopSearch(long handle);
+    private static native int[] getComputerMove(long handle);
+    private static native String getSearchInfo(long handle);
+    private static native String bench(int depth, boolean withNetwork);
+}
@@ -20,6 +20,7 @@ public class Settings extends AppCompatActivity {
     private Switch soundSwitch;
     private Switch vibrationSwitch;
     private Switch animationSwitch;
+    private Switch ponderSwitch;
     private SeekBar volumeSeekBar;
     private TextView volumeText;
     private TextView versionText;
@@ -43,6 +44,7 @@ public class Settings extends AppCompatActivity {
         soundSwitch = findViewById(R.id.soundSwitch);
         vibrationSwitch = findViewById(R.id.vibrationSwitch);
         animationSwitch = findViewById(R.id.animationSwitch);
+        ponderSwitch = findViewById(R.id.ponderSwitch);
         volumeSeekBar = findViewById(R.id.volumeSeekBar);
         volumeText = findViewById(R.id.volumeText);
         versionText = findViewById(R.id.versionText);
@@ -76,6 +78,7 @@ public class Settings extends AppCompatActivity {
         soundSwitch.setChecked(prefs.getBoolean("sound", true));
         vibrationSwitch.setChecked(prefs.getBoolean("vibration", true));
         animationSwitch.setChecked(prefs.getBoolean("animation", true));
+        ponderSwitch.setChecked(prefs.getBoolean("ponder", false));
 
         int volume = prefs.getInt("volume", 50);
         volumeSeekBar.setProgress(volume);
@@ -135,6 +138,7 @@ public class Settings extends AppCompatActivity {
         editor.putBoolean("sound", soundSwitch.isChecked());
         editor.putBoolean("vibration", vibrationSwitch.isChecked());
         editor.putBoolean("animation", animationSwitch.isChecked());
+        editor.putBoolean("ponder", ponderSwitch.isChecked());
         editor.putInt("volume", volumeSeekBar.getProgress());
 
         editor.apply();
@@ -0,0 +1,88 @@
+// Search benchmark. Runs getBestMove to a fixed depth over the built-in
+// positions on one thread and prints nodes, time and speed. The node total
+// is the search's signature: a change that is not meant to alter the
+// search must leave it as it was.
+//
+//   bench                    the default depth
+//   bench --depth N          another depth
+//   bench --network FILE     evaluate with an NNUE network
+//   bench --check            fail unless the default run's signature is
+//                            BENCH_SIGNATURE, as the bench test does
+//
+// --quiet leaves out the line per position. A built-in position that does
+// not parse fails the run.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "engine/bench.h"
+#include "engine/nnue.h"
+
+namespace {
+
+void printUsage() {
+    std::printf("usage: bench [--depth N] [--network FILE] [--check] [--quiet]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int depth = DEFAULT_BENCH_DEPTH;
+    std::string networkPath;
+    bool quiet = false;
+    bool check = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--depth" && hasValue) {
+            depth = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--network" && hasValue) {
+            networkPath = argv[++i];
+        } else if (arg == "--check") {
+            check = true;
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    // The expected signature is for the default run only
+    if (check && (depth != DEFAULT_BENCH_DEPTH || !networkPath.empty())) {
+        std::fprintf(stderr, "--check needs the default depth and no network\n");
+        return 2;
+    }
+
+    NnueNetwork network;
+    if (!networkPath.empty() && !network.load(networkPath)) {
+        std::fprintf(stderr, "cannot load network %s\n", networkPath.c_str());
+        return 2;
+    }
+
+    BenchResult result = runBench(depth, networkPath.empty() ? nullptr : &network, [quiet](const BenchLine& line) {
+        if (quiet) return;
+        std::printf("%2d  %-5s nodes %10llu  time %6d ms  %s\n", line.index + 1,
+                    moveToString(line.bestMove).c_str(), static_cast<unsigned long long>(line.nodes),
+                    line.timeMs, line.fen);
+    });
+
+    std::printf("positions %d  depth %d  evaluation %s\n", result.positions, depth,
+                networkPath.empty() ? "piece-square tables" : "network");
+    std::printf("nodes %llu  time %d ms  nps %llu\n", static_cast<unsigned long long>(result.nodes),
+                result.timeMs, static_cast<unsigned long long>(result.nodesPerSecond()));
+    std::printf("signature %llu\n", static_cast<unsigned long long>(result.nodes));
+
+    if (result.invalidPositions > 0) {
+        std::printf("FAILED: %d positions did not parse\n", result.invalidPositions);
+        return 1;
+    }
+    if (check && result.nodes != BENCH_SIGNATURE) {
+        std::printf("FAILED: expected signature %llu\n", static_cast<unsigned long long>(BENCH_SIGNATURE));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+// Search benchmark: the real getBestMove at fixed depth over a built-in
+// set of positions, for tracking speed across builds and devices
+#ifndef CHECKMATE_ENGINE_BENCH_H
+#define CHECKMATE_ENGINE_BENCH_H
+
+#include <cstdint>
+#include <functional>
+
+#include "nnue.h"
+#include "types.h"
+
+const int DEFAULT_BENCH_DEPTH = 10;
+
+// Fixed, so the node counts do not depend on how the table is sized
+const int BENCH_HASH_MB = 16;
+
+// The signature at the default depth with the piece-square tables, which
+// the bench test checks. A change meant to alter the search updates it.
+const uint64_t BENCH_SIGNATURE = 10040545;
+
+// One searched position
+struct BenchLine {
+    int index;
+    const char* fen;
+    Move bestMove;
+    uint64_t nodes;
+    int timeMs;
+};
+
+struct BenchResult {
+    int positions = 0;
+    // The signature: one thread, a cleared table per position and no
+    // random move choice make it the same on every machine, and it only
+    // changes when the search or evaluation does
+    uint64_t nodes = 0;
+    int timeMs = 0;
+
+    // Built-in positions that did not parse, skipped rather than searched
+    int invalidPositions = 0;
+
+    uint64_t nodesPerSecond() const {
+        return nodes * 1000 / static_cast<uint64_t>(timeMs > 0 ? timeMs : 1);
+    }
+};
+
+// Searches every position to depth on the calling thread, evaluating with
+// network, or the piece-square tables when it is null. report, if set, is
+// called after each position.
+BenchResult runBench(int depth, const NnueNetwork* network,
+                     const std::function<void(const BenchLine&)>& report = nullptr);
+
+#endif // CHECKMATE_ENGINE_BENCH_H
@@ -0,0 +1,210 @@
+#include "bitboard.h"
+
+// Attack sets for the non-sliding pieces, indexed by square
+Bitboard knightAttacks[64];
+Bitboard kingAttacks[64];
+Bitboard pawnAttacks[3][64];
+
+static const int bishopDirections[4][2] = {{-1,-1},{-1,1},{1,-1},{1,1}};
+static const int rookDirections[4][2] = {{-1,0},{1,0},{0,-1},{0,1}};
+
+static Bitboard leaperAttacks(int sq, const int offsets[][2], int numOffsets) {
+    Bitboard attacks = 0;
+    for (int i = 0; i < numOffsets; i++) {
+        int r = rowOf(sq) + offsets[i][0];
+        int c = colOf(sq) + offsets[i][1];
+        if (r >= 0 && r < 8 && c >= 0 && c < 8) {
+            attacks |= squareBB(squareOf(r, c));
+        }
+    }
+    return attacks;
+}
+
+static Bitboard slidingAttacks(int sq, Bitboard occupied, const int directions[][2], int numDirs) {
+    Bitboard attacks = 0;
+    for (int d = 0; d < numDirs; d++) {
+        for (int dist = 1; dist < 8; dist++) {
+            int r = rowOf(sq) + directions[d][0] * dist;
+            int c = colOf(sq) + directions[d][1] * dist;
+            if (r < 0 || r >= 8 || c < 0 || c >= 8) break;
+
+            Bitboard target = squareBB(squareOf(r, c));
+            attacks |= target;
+            if (occupied & target) break;
+        }
+    }
+    return attacks;
+}
+
+Magic bishopMagics[64];
+Magic rookMagics[64];
+
+static Bitboard bishopAttackTable[0x1480];
+static Bitboard rookAttackTable[0x19000];
+
+// xorshift64* generator used to fill the startup tables deterministically
+class TableRng {
+private:
+    uint64_t state;
+
+public:
+    explicit TableRng(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+
+    // Magics with few set bits are found much faster
+    uint64_t sparse() {
+        return next() & next() & next();
+    }
+};
+
+static void initMagics(Magic magics[], Bitboard table[], const int directions[][2]) {
+    const Bitboard rankEdges = 0xFF000000000000FFULL;
+    const Bitboard fileEdges = 0x8181818181818181ULL;
+
+    Bitboard reference[4096];
+#if !defined(__BMI2__)
+    // Seeds per row that are known to find magics quickly
+    const uint64_t seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+    Bitboard occupancy[4096];
+    int epoch[4096] = {0};
+    int attempt = 0;
+#endif
+    Bitboard* next = table;
+
+    for (int sq = 0; sq < 64; sq++) {
+        Bitboard rowBB = 0xFFULL << (8 * rowOf(sq));
+        Bitboard colBB = 0x0101010101010101ULL << colOf(sq);
+        Bitboard edges = (rankEdges & ~rowBB) | (fileEdges & ~colBB);
+
+        Magic& m = magics[sq];
+        m.mask = slidingAttacks(sq, 0, directions, 4) & ~edges;
+        m.shift = 64 - popCount(m.mask);
+        m.attacks = next;
+
+        // Enumerate every subset of the mask (Carry-Rippler) with its attack set
+        int size = 0;
+        Bitboard b = 0;
+        do {
+            reference[size] = slidingAttacks(sq, b, directions, 4);
+#if defined(__BMI2__)
+            m.attacks[_pext_u64(b, m.mask)] = reference[size];
+#else
+            occupancy[size] = b;
+#endif
+            size++;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+        next += size;
+
+#if !defined(__BMI2__)
+        TableRng rng(seeds[rowOf(sq)]);
+        for (int i = 0; i < size; ) {
+            for (m.magic = 0; popCount((m.magic * m.mask) >> 56) < 6; ) {
+                m.magic = rng.sparse();
+            }
+
+            // A magic is good when no two occupancies with different attack
+            // sets collide; epoch[] avoids clearing the table per attempt.
+            attempt++;
+            for (i = 0; i < size; i++) {
+                unsigned idx = m.index(occupancy[i]);
+                if (epoch[idx] < attempt) {
+                    epoch[idx] = attempt;
+                    m.attacks[idx] = reference[i];
+                } else if (m.attacks[idx] != reference[i]) {
+                    break;
+                }
+            }
+        }
+#endif
+    }
+}
+
+static bool initAttackTables() {
+    const int knightOffsets[8][2] = {{-2,-1},{-2,1},{-1,-2},{-1,2},{1,-2},{1,2},{2,-1},{2,1}};
+    const int kingOffsets[8][2] = {{-1,-1},{-1,0},{-1,1},{0,-1},{0,1},{1,-1},{1,0},{1,1}};
+    const int whitePawnOffsets[2][2] = {{-1,-1},{-1,1}};
+    const int blackPawnOffsets[2][2] = {{1,-1},{1,1}};
+
+    for (int sq = 0; sq < 64; sq++) {
+        knightAttacks[sq] = leaperAttacks(sq, knightOffsets, 8);
+        kingAttacks[sq] = leaperAttacks(sq, kingOffsets, 8);
+        pawnAttacks[NONE][sq] = 0;
+        pawnAttacks[WHITE][sq] = leaperAttacks(sq, whitePawnOffsets, 2);
+        pawnAttacks[BLACK][sq] = leaperAttacks(sq, blackPawnOffsets, 2);
+    }
+
+    initMagics(bishopMagics, bishopAttackTable, bishopDirections);
+    initMagics(rookMagics, rookAttackTable, rookDirections);
+    return true;
+}
+
+ZobristKeys zobrist;
+
+static bool initZobristKeys() {
+    TableRng rng(1070372);
+
+    for (int c = 0; c < 3; c++) {
+        for (int t = 0; t < 7; t++) {
+            for (int sq = 0; sq < 64; sq++) {
+                zobrist.pieceSquare[c][t][sq] = (c == NONE || t == EMPTY) ? 0 : rng.next();
+            }
+        }
+    }
+
+    // Combined rights hash as the xor of their single-right keys
+    uint64_t rightKeys[4];
+    for (int i = 0; i < 4; i++) rightKeys[i] = rng.next();
+    for (int rights = 0; rights < 16; rights++) {
+        zobrist.castling[rights] = 0;
+        for (int i = 0; i < 4; i++) {
+            if (rights & (1 << i)) zobrist.castling[rights] ^= rightKeys[i];
+        }
+    }
+
+    for (int f = 0; f < 8; f++) {
+        zobrist.enPassantFile[f] = rng.next();
+    }
+    zobrist.blackToMove = rng.next();
+    return true;
+}
+
+Bitboard betweenBB[64][64];
+Bitboard lineBB[64][64];
+
+static bool initLineTables() {
+    for (int a = 0; a < 64; a++) {
+        for (int b = 0; b < 64; b++) {
+            betweenBB[a][b] = 0;
+            lineBB[a][b] = 0;
+            if (a == b) continue;
+
+            if (bishopAttacks(a, 0) & squareBB(b)) {
+                betweenBB[a][b] = bishopAttacks(a, squareBB(b)) & bishopAttacks(b, squareBB(a));
+                lineBB[a][b] = (bishopAttacks(a, 0) & bishopAttacks(b, 0)) | squareBB(a) | squareBB(b);
+            } else if (rookAttacks(a, 0) & squareBB(b)) {
+                betweenBB[a][b] = rookAttacks(a, squareBB(b)) & rookAttacks(b, squareBB(a));
+                lineBB[a][b] = (rookAttacks(a, 0) & rookAttacks(b, 0)) | squareBB(a) | squareBB(b);
+            }
+        }
+    }
+    return true;
+}
+
+void ensureTablesInit() {
+    static const bool attacksReady = initAttackTables();
+    static const bool linesReady = initLineTables();
+    static const bool zobristReady = initZobristKeys();
+    (void)attacksReady;
+    (void)linesReady;
+    (void)zobristReady;
+}
+
+// Build the tables when the library is loaded rather than on the first game
+static const bool tablesLoaded = (ensureTablesInit(), true);
@@ -0,0 +1,88 @@
+// Bitboard helpers and the precomputed attack, line and Zobrist tables
+#ifndef CHECKMATE_ENGINE_BITBOARD_H
+#define CHECKMATE_ENGINE_BITBOARD_H
+
+#include <cstdint>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "types.h"
+
+inline int squareOf(int row, int col) { return row * 8 + col; }
+inline int rowOf(int sq) { return sq >> 3; }
+inline int colOf(int sq) { return sq & 7; }
+inline Bitboard squareBB(int sq) { return 1ULL << sq; }
+inline int popCount(Bitboard b) { return __builtin_popcountll(b); }
+inline int lsb(Bitboard b) { return __builtin_ctzll(b); }
+
+inline int popLsb(Bitboard& b) {
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+inline Color opposite(Color c) {
+    return (c == WHITE) ? BLACK : WHITE;
+}
+
+// Attack sets for the non-sliding pieces, indexed by square
+extern Bitboard knightAttacks[64];
+extern Bitboard kingAttacks[64];
+extern Bitboard pawnAttacks[3][64];
+
+// Fancy magic bitboards: each square's relevant occupancy (the ray squares
+// minus the board edge) is hashed to an index into a shared attack table.
+// With BMI2 the index is a single PEXT and no magic multiplier is needed.
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    Bitboard* attacks;
+    int shift;
+
+    unsigned index(Bitboard occupied) const {
+#if defined(__BMI2__)
+        return static_cast<unsigned>(_pext_u64(occupied, mask));
+#else
+        return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+#endif
+    }
+};
+
+extern Magic bishopMagics[64];
+extern Magic rookMagics[64];
+
+inline Bitboard bishopAttacks(int sq, Bitboard occupied) {
+    const Magic& m = bishopMagics[sq];
+    return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard rookAttacks(int sq, Bitboard occupied) {
+    const Magic& m = rookMagics[sq];
+    return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard queenAttacks(int sq, Bitboard occupied) {
+    return bishopAttacks(sq, occupied) | rookAttacks(sq, occupied);
+}
+
+// For squares on a common rank, file or diagonal: the squares strictly
+// between them and the full line through both. Empty for unaligned pairs.
+extern Bitboard betweenBB[64][64];
+extern Bitboard lineBB[64][64];
+
+// Zobrist keys. The seed is fixed so a position hashes to the same key on
+// every run and every device.
+struct ZobristKeys {
+    uint64_t pieceSquare[3][7][64];
+    uint64_t castling[16];
+    uint64_t enPassantFile[8];
+    uint64_t blackToMove;
+};
+
+extern ZobristKeys zobrist;
+
+// Builds every startup table; safe to call more than once
+void ensureTablesInit();
+
+#endif // CHECKMATE_ENGINE_BITBOARD_H
@@ -0,0 +1,135 @@
+#include "book.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "chess_game.h"
+#include "log.h"
+
+namespace {
+
+const uint32_t BOOK_VERSION = 1;
+const size_t HEADER_SIZE = 16;
+
+static_assert(sizeof(BookEntry) == 16, "book entries are 16 bytes on disk");
+
+// The legal move a packed book move stands for, or the null move
+Move unpackMove(ChessGame& game, uint16_t packed) {
+    int from = packed & 0x3F;
+    int to = (packed >> 6) & 0x3F;
+    int promotion = packed >> 12;
+
+    MoveList moves;
+    game.generateLegalMoves(moves);
+    for (const Move& move : moves) {
+        if (move.from() != from || move.to() != to) continue;
+        if (move.isPromotion() ? move.promotionType() == promotion : promotion == 0) return move;
+    }
+    return Move::none();
+}
+
+} // namespace
+
+OpeningBook::OpeningBook() : mapping(nullptr), mappingSize(0), entries(nullptr), count(0) {}
+
+OpeningBook::~OpeningBook() {
+    close();
+}
+
+void OpeningBook::close() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    entries = nullptr;
+    count = 0;
+}
+
+bool OpeningBook::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGE("Cannot open book %s", path.c_str());
+        return false;
+    }
+
+    struct stat info;
+    size_t size = 0;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= HEADER_SIZE) {
+        size = static_cast<size_t>(info.st_size);
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        LOGE("Book %s is too short or cannot be mapped", path.c_str());
+        return false;
+    }
+
+    const char* bytes = static_cast<const char*>(data);
+    uint32_t header[2];
+    std::memcpy(header, bytes + 4, sizeof(header));
+    if (std::memcmp(bytes, "CMBK", 4) != 0 || header[0] != BOOK_VERSION ||
+        size != HEADER_SIZE + static_cast<size_t>(header[1]) * sizeof(BookEntry)) {
+        LOGE("Book %s has an unsupported format", path.c_str());
+        munmap(data, size);
+        return false;
+    }
+
+    // Probes are a few page touches each, so there is no point reading
+    // ahead
+    madvise(data, size, MADV_RANDOM);
+
+    mapping = data;
+    mappingSize = size;
+    entries = reinterpret_cast<const BookEntry*>(bytes + HEADER_SIZE);
+    count = header[1];
+    LOGD("Loaded book %s, %zu entries", path.c_str(), count);
+    return true;
+}
+
+Move OpeningBook::probe(ChessGame& game, RandomGenerator& random) const {
+    if (!entries) return Move::none();
+
+    uint64_t key = game.getHash();
+    const BookEntry* end = entries + count;
+    const BookEntry* first = std::lower_bound(entries, end, key,
+                                              [](const BookEntry& entry, uint64_t k) { return entry.key < k; });
+
+    // Entries that are not legal here belong to another position with
+    // the same key and are left out of the draw
+    Move moves[MAX_MOVES];
+    int weights[MAX_MOVES];
+    int found = 0;
+    int total = 0;
+    for (const BookEntry* entry = first; entry != end && entry->key == key && found < MAX_MOVES; entry++) {
+        if (entry->weight == 0) continue;
+        Move move = unpackMove(game, entry->move);
+        if (move.isNull()) continue;
+        moves[found] = move;
+        weights[found] = entry->weight;
+        total += entry->weight;
+        found++;
+    }
+    if (found == 0) return Move::none();
+
+    int pick = random.getBelow(total);
+    for (int i = 0; i < found; i++) {
+        pick -= weights[i];
+        if (pick < 0) return moves[i];
+    }
+    return moves[found - 1];
+}
+
+uint16_t OpeningBook::packMove(const Move& move) {
+    int promotion = move.isPromotion() ? move.promotionType() : 0;
+    return static_cast<uint16_t>(move.from() | (move.to() << 6) | (promotion << 12));
+}
@@ -0,0 +1,63 @@
+// Opening book: known replies for known positions, played without a search
+#ifndef CHECKMATE_ENGINE_BOOK_H
+#define CHECKMATE_ENGINE_BOOK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "random.h"
+#include "types.h"
+
+class ChessGame;
+
+// One book move, 16 bytes little-endian as in the Polyglot format. The
+// move is packed as from | to << 6 | promotion << 12 with the promotion
+// piece as a PieceType, zero for none; flags are recovered from the
+// position when the book is probed.
+struct BookEntry {
+    uint64_t key;       // ChessGame::getHash() of the position
+    uint16_t move;
+    uint16_t weight;    // Relative frequency among the position's moves
+    uint32_t reserved;
+};
+
+// A book file mapped read-only into memory. Layout:
+//
+//   char     magic[4]    "CMBK"
+//   uint32_t version     1
+//   uint32_t count       number of entries
+//   (zero padding to 16 bytes)
+//   BookEntry entries[count], sorted by key
+//
+// Keys are the engine's own Zobrist keys, so a book built by makebook only
+// matches an engine with the same keys.
+class OpeningBook {
+public:
+    OpeningBook();
+    ~OpeningBook();
+
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    // Maps the file at path, replacing any book opened before. On a
+    // missing or malformed file nothing is opened and false is returned.
+    bool open(const std::string& path);
+    bool isOpen() const { return mapping != nullptr; }
+
+    // A legal book move for the position, chosen at random in proportion
+    // to the weights; the null move when the position is not in the book
+    Move probe(ChessGame& game, RandomGenerator& random) const;
+
+    static uint16_t packMove(const Move& move);
+
+private:
+    void* mapping;
+    size_t mappingSize;
+    const BookEntry* entries;
+    size_t count;
+
+    void close();
+};
+
+#endif // CHECKMATE_ENGINE_BOOK_H
@@ -0,0 +1,1567 @@
+#include "chess_game.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#include "log.h"
+#include "move_picker.h"
+
+static const int pieceValues[7] = {0, 100, 320, 330, 500, 900, 20000};
+
+// Material plus piece-square bonus per color, piece and square, negative
+// for Black, so evaluation needs neither mirroring nor a sign per piece.
+// Only the king's table differs between the middlegame and the endgame.
+static int pieceSquareMg[3][7][64];
+static int pieceSquareEg[3][7][64];
+
+// Game phase: 24 with all minor and major pieces on the board, 0 with none
+static const int phaseWeight[7] = {0, 0, 1, 1, 2, 4, 0};
+static const int MAX_PHASE = 24;
+
+bool ChessGame::initPieceSquareTables() {
+    const int (*middlegame[7])[8] = {
+        nullptr, pawnTableWhite, knightTable, bishopTable, rookTable, queenTable, kingTableMiddle
+    };
+    const int (*endgame[7])[8] = {
+        nullptr, pawnTableWhite, knightTable, bishopTable, rookTable, queenTable, kingTableEnd
+    };
+
+    for (int type = PAWN; type <= KING; type++) {
+        // Both kings are always on the board, so their material is left out
+        int value = (type == KING) ? 0 : pieceValues[type];
+        for (int sq = 0; sq < 64; sq++) {
+            int row = rowOf(sq), col = colOf(sq);
+            pieceSquareMg[WHITE][type][sq] = value + middlegame[type][row][col];
+            pieceSquareEg[WHITE][type][sq] = value + endgame[type][row][col];
+            pieceSquareMg[BLACK][type][sq] = -(value + middlegame[type][7 - row][col]);
+            pieceSquareEg[BLACK][type][sq] = -(value + endgame[type][7 - row][col]);
+        }
+    }
+    return true;
+}
+
+void ChessGame::clearBoard() {
+    for (int c = 0; c < 3; c++) {
+        colorBB[c] = 0;
+        for (int t = 0; t < 7; t++) {
+            pieceBB[c][t] = 0;
+        }
+    }
+    occupied = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        mailbox[sq] = Piece();
+    }
+    kingSquare[NONE] = kingSquare[WHITE] = kingSquare[BLACK] = -1;
+    hash = 0;
+    pawnKey = 0;
+    mgScore = egScore = gamePhase = 0;
+    if (network) network->refresh(accumulator, mailbox);
+}
+
+void ChessGame::putPiece(int sq, const Piece& piece) {
+    Bitboard bb = squareBB(sq);
+    mailbox[sq] = piece;
+    pieceBB[piece.color][piece.type] |= bb;
+    colorBB[piece.color] |= bb;
+    occupied |= bb;
+    hash ^= zobrist.pieceSquare[piece.color][piece.type][sq];
+    if (piece.type == PAWN) pawnKey ^= zobrist.pieceSquare[piece.color][PAWN][sq];
+    mgScore += pieceSquareMg[piece.color][piece.type][sq];
+    egScore += pieceSquareEg[piece.color][piece.type][sq];
+    gamePhase += phaseWeight[piece.type];
+    if (network) network->addPiece(accumulator, piece, sq);
+    if (piece.type == KING) kingSquare[piece.color] = sq;
+}
+
+void ChessGame::removePiece(int sq) {
+    Piece piece = mailbox[sq];
+    if (piece.type == EMPTY) return;
+
+    Bitboard bb = squareBB(sq);
+    pieceBB[piece.color][piece.type] &= ~bb;
+    colorBB[piece.color] &= ~bb;
+    occupied &= ~bb;
+    mailbox[sq] = Piece();
+    hash ^= zobrist.pieceSquare[piece.color][piece.type][sq];
+    if (piece.type == PAWN) pawnKey ^= zobrist.pieceSquare[piece.color][PAWN][sq];
+    mgScore -= pieceSquareMg[piece.color][piece.type][sq];
+    egScore -= pieceSquareEg[piece.color][piece.type][sq];
+    gamePhase -= phaseWeight[piece.type];
+    if (network) network->removePiece(accumulator, piece, sq);
+}
+
+void ChessGame::movePiece(int from, int to) {
+    Piece piece = mailbox[from];
+    removePiece(from);
+    putPiece(to, piece);
+}
+
+ChessGame::ChessGame()
+    : initialized(false), network(nullptr), tt(nullptr), tablebases(nullptr), pawnTable(nullptr), random(nullptr),
+      hasDeadline(false), stopped(false), stopSignal(nullptr), ponderSignal(nullptr), rootDepth(0), nodes(0), nodeLimit(0),
+      selDepth(0), nodeCounter(nullptr) {
+    LOGD("ChessGame constructor called");
+    ensureTablesInit();
+    static const bool pieceSquareReady = initPieceSquareTables();
+    (void)pieceSquareReady;
+    clearMoveOrdering();
+    initializeBoard();
+}
+
+ChessGame::~ChessGame() {
+    LOGD("ChessGame destructor called");
+}
+
+void ChessGame::copyPosition(const ChessGame& other) {
+    if (&other == this) return;
+
+    std::copy(&other.pieceBB[0][0], &other.pieceBB[0][0] + 3 * 7, &pieceBB[0][0]);
+    std::copy(other.colorBB, other.colorBB + 3, colorBB);
+    occupied = other.occupied;
+    std::copy(other.mailbox, other.mailbox + 64, mailbox);
+    std::copy(other.kingSquare, other.kingSquare + 3, kingSquare);
+    currentPlayer = other.currentPlayer;
+    castlingRights = other.castlingRights;
+    enPassantSquare = other.enPassantSquare;
+    halfMoveClock = other.halfMoveClock;
+    fullMoveNumber = other.fullMoveNumber;
+    initialized = other.initialized;
+    hash = other.hash;
+    pawnKey = other.pawnKey;
+    mgScore = other.mgScore;
+    egScore = other.egScore;
+    gamePhase = other.gamePhase;
+
+    network = other.network;
+    if (network) accumulator = other.accumulator;
+
+    // Only the moves played, which the repetition check looks back over
+    undoCount = other.undoCount;
+    std::copy(other.undoStack, other.undoStack + undoCount, undoStack);
+
+    tt = other.tt;
+    tablebases = other.tablebases;
+    options = other.options;
+}
+
+void ChessGame::initializeBoard() {
+    try {
+        LOGD("Initializing board...");
+
+        clearBoard();
+
+        // Setup black pieces
+        const PieceType backRank[8] = {ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK};
+        for (int i = 0; i < 8; i++) {
+            putPiece(squareOf(0, i), Piece(backRank[i], BLACK));
+            putPiece(squareOf(1, i), Piece(PAWN, BLACK));
+        }
+
+        // Setup white pieces
+        for (int i = 0; i < 8; i++) {
+            putPiece(squareOf(7, i), Piece(backRank[i], WHITE));
+            putPiece(squareOf(6, i), Piece(PAWN, WHITE));
+        }
+
+        currentPlayer = WHITE;
+        castlingRights = ALL_CASTLING;
+        enPassantSquare = -1;
+        halfMoveClock = 0;
+        fullMoveNumber = 1;
+        undoCount = 0;
+        hash = computeHash();
+        initialized = true;
+
+        LOGD("Board initialized successfully");
+    } catch (const std::exception& e) {
+        LOGE("Exception in initializeBoard: %s", e.what());
+        initialized = false;
+    } catch (...) {
+        LOGE("Unknown exception in initializeBoard");
+        initialized = false;
+    }
+}
+
+bool ChessGame::setFromFen(const std::string& fen) {
+    try {
+        std::istringstream in(fen);
+        std::string placement, side, castling, enPassant;
+        int halfMoves = 0, fullMoves = 1;
+        in >> placement >> side >> castling >> enPassant;
+        if (!(in >> halfMoves)) halfMoves = 0;
+        if (!(in >> fullMoves)) fullMoves = 1;
+
+        if (placement.empty() || (side != "w" && side != "b")) {
+            LOGE("Invalid FEN: %s", fen.c_str());
+            initializeBoard();
+            return false;
+        }
+
+        clearBoard();
+
+        const std::string pieceChars = " pnbrqk";
+        int row = 0, col = 0;
+        for (char ch : placement) {
+            if (ch == '/') {
+                row++;
+                col = 0;
+            } else if (ch >= '1' && ch <= '8') {
+                col += ch - '0';
+            } else {
+                size_t type = pieceChars.find(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
+                if (type == std::string::npos || type == 0 || row > 7 || col > 7) {
+                    LOGE("Invalid FEN: %s", fen.c_str());
+                    initializeBoard();
+                    return false;
+                }
+                Color color = std::isupper(static_cast<unsigned char>(ch)) ? WHITE : BLACK;
+                putPiece(squareOf(row, col), Piece(static_cast<PieceType>(type), color));
+                col++;
+            }
+        }
+
+        if (popCount(pieceBB[WHITE][KING]) != 1 || popCount(pieceBB[BLACK][KING]) != 1) {
+            LOGE("Invalid FEN, each side needs one king: %s", fen.c_str());
+            initializeBoard();
+            return false;
+        }
+
+        currentPlayer = (side == "w") ? WHITE : BLACK;
+
+        castlingRights = 0;
+        for (char ch : castling) {
+            if (ch == 'K') castlingRights |= WHITE_KINGSIDE;
+            if (ch == 'Q') castlingRights |= WHITE_QUEENSIDE;
+            if (ch == 'k') castlingRights |= BLACK_KINGSIDE;
+            if (ch == 'q') castlingRights |= BLACK_QUEENSIDE;
+        }
+
+        // Like makeMove, only keep an en passant square that can be taken
+        enPassantSquare = -1;
+        if (enPassant.size() == 2 && enPassant[0] >= 'a' && enPassant[0] <= 'h' &&
+            enPassant[1] >= '1' && enPassant[1] <= '8') {
+            int sq = squareOf('8' - enPassant[1], enPassant[0] - 'a');
+            if (pawnAttacks[opposite(currentPlayer)][sq] & pieceBB[currentPlayer][PAWN]) {
+                enPassantSquare = sq;
+            }
+        }
+
+        halfMoveClock = halfMoves;
+        fullMoveNumber = fullMoves;
+        undoCount = 0;
+        hash = computeHash();
+        initialized = true;
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("Exception in setFromFen: %s", e.what());
+    } catch (...) {
+        LOGE("Unknown exception in setFromFen");
+    }
+    initializeBoard();
+    return false;
+}
+
+uint64_t ChessGame::computeHash() const {
+    uint64_t key = 0;
+    for (int c = WHITE; c <= BLACK; c++) {
+        for (int t = PAWN; t <= KING; t++) {
+            Bitboard pieces = pieceBB[c][t];
+            while (pieces) {
+                key ^= zobrist.pieceSquare[c][t][popLsb(pieces)];
+            }
+        }
+    }
+    key ^= zobrist.castling[castlingRights];
+    if (enPassantSquare != -1) key ^= zobrist.enPassantFile[colOf(enPassantSquare)];
+    if (currentPlayer == BLACK) key ^= zobrist.blackToMove;
+    return key;
+}
+
+std::string ChessGame::verifyIncremental() const {
+    uint64_t pawns = 0;
+    int mg = 0, eg = 0, phase = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        const Piece& piece = mailbox[sq];
+        if (piece.type == EMPTY) continue;
+        if (piece.type == PAWN) pawns ^= zobrist.pieceSquare[piece.color][PAWN][sq];
+        mg += pieceSquareMg[piece.color][piece.type][sq];
+        eg += pieceSquareEg[piece.color][piece.type][sq];
+        phase += phaseWeight[piece.type];
+    }
+
+    if (pawns != pawnKey) return "pawn key";
+    if (mg != mgScore) return "middlegame score";
+    if (eg != egScore) return "endgame score";
+    if (phase != gamePhase) return "game phase";
+
+    if (network) {
+        NnueAccumulator reference;
+        network->refreshScalar(reference, mailbox);
+        if (std::memcmp(&reference, &accumulator, sizeof(reference)) != 0) return "network accumulator";
+        if (network->evaluate(accumulator, currentPlayer) != network->evaluateScalar(reference, currentPlayer)) {
+            return "network evaluation";
+        }
+    }
+    return "";
+}
+
+int ChessGame::getPiece(int row, int col) {
+    if (row < 0 || row >= 8 || col < 0 || col >= 8) {
+        LOGE("Invalid board access: %d, %d", row, col);
+        return 0;
+    }
+
+    try {
+        Piece p = mailbox[squareOf(row, col)];
+        if (p.type == EMPTY) return 0;
+        return (p.color * 10) + p.type;
+    } catch (...) {
+        LOGE("Exception in getPiece");
+        return 0;
+    }
+}
+
+void ChessGame::getBoard(int codes[64]) const {
+    for (int sq = 0; sq < 64; sq++) {
+        const Piece& p = mailbox[sq];
+        codes[sq] = (p.type == EMPTY) ? 0 : (p.color * 10) + p.type;
+    }
+}
+
+std::vector<Move> ChessGame::getLegalMoves(int row, int col) {
+    std::vector<Move> moves;
+    try {
+        if (!initialized || !isValidPosition(row, col)) return moves;
+
+        int sq = squareOf(row, col);
+        Piece piece = mailbox[sq];
+        if (piece.type == EMPTY || piece.color != currentPlayer) return moves;
+
+        MoveList legalMoves;
+        generateLegalMoves(legalMoves);
+
+        for (const Move& move : legalMoves) {
+            if (move.from() == sq) {
+                moves.push_back(move);
+            }
+        }
+    } catch (const std::exception& e) {
+        LOGE("Exception in getLegalMoves: %s", e.what());
+    } catch (...) {
+        LOGE("Unknown exception in getLegalMoves");
+    }
+
+    return moves;
+}
+
+Bitboard ChessGame::attackersTo(int sq, Bitboard occ) {
+    return (pawnAttacks[WHITE][sq] & pieceBB[BLACK][PAWN])
+         | (pawnAttacks[BLACK][sq] & pieceBB[WHITE][PAWN])
+         | (knightAttacks[sq] & (pieceBB[WHITE][KNIGHT] | pieceBB[BLACK][KNIGHT]))
+         | (kingAttacks[sq] & (pieceBB[WHITE][KING] | pieceBB[BLACK][KING]))
+         | (bishopAttacks(sq, occ) & (pieceBB[WHITE][BISHOP] | pieceBB[BLACK][BISHOP] |
+                                      pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN]))
+         | (rookAttacks(sq, occ) & (pieceBB[WHITE][ROOK] | pieceBB[BLACK][ROOK] |
+                                    pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN]));
+}
+
+Bitboard ChessGame::pinnedPieces(Color color) {
+    Color them = opposite(color);
+    int king = kingSquare[color];
+    Bitboard snipers =
+        (rookAttacks(king, 0) & (pieceBB[them][ROOK] | pieceBB[them][QUEEN])) |
+        (bishopAttacks(king, 0) & (pieceBB[them][BISHOP] | pieceBB[them][QUEEN]));
+
+    Bitboard pinned = 0;
+    while (snipers) {
+        Bitboard blockers = betweenBB[king][popLsb(snipers)] & occupied;
+        if (blockers && !(blockers & (blockers - 1))) {
+            pinned |= blockers & colorBB[color];
+        }
+    }
+    return pinned;
+}
+
+CheckInfo ChessGame::getCheckInfo() {
+    CheckInfo info;
+    info.checkers = attackersTo(kingSquare[currentPlayer], occupied) & colorBB[opposite(currentPlayer)];
+    info.pinned = pinnedPieces(currentPlayer);
+    return info;
+}
+
+void ChessGame::generateLegalMoves(MoveList& moves, GenType type) {
+    generateLegalMoves(moves, type, getCheckInfo());
+}
+
+void ChessGame::generateLegalMoves(MoveList& moves, GenType type, const CheckInfo& info) {
+    Color us = currentPlayer, them = opposite(us);
+    int king = kingSquare[us];
+    Bitboard own = colorBB[us], enemy = colorBB[them];
+    Bitboard targetMask = (type == GEN_CAPTURES) ? enemy : (type == GEN_QUIETS) ? ~occupied : ~own;
+
+    // The king is lifted off the board so it cannot hide behind itself
+    Bitboard kingTargets = kingAttacks[king] & targetMask;
+    Bitboard withoutKing = occupied ^ squareBB(king);
+    while (kingTargets) {
+        int to = popLsb(kingTargets);
+        if (!(attackersTo(to, withoutKing) & enemy)) {
+            moves.add(Move(king, to, (enemy & squareBB(to)) ? CAPTURE : QUIET));
+        }
+    }
+
+    // In double check only the king can move
+    Bitboard checkers = info.checkers;
+    if (checkers & (checkers - 1)) return;
+
+    // Otherwise every move must capture the checker or block its ray
+    Bitboard checkMask = checkers ? (betweenBB[king][lsb(checkers)] | checkers) : ~0ULL;
+
+    for (int pt = KNIGHT; pt <= QUEEN; pt++) {
+        Bitboard pieces = pieceBB[us][pt];
+        while (pieces) {
+            int from = popLsb(pieces);
+            Bitboard targets = pieceAttacks(static_cast<PieceType>(pt), from) & targetMask & checkMask;
+            if (info.pinned & squareBB(from)) targets &= lineBB[king][from];
+            addMoves(from, targets, moves);
+        }
+    }
+
+    generatePawnMoves(type, checkMask, info.pinned, moves);
+
+    if (!checkers && type != GEN_CAPTURES) generateCastling(moves);
+}
+
+Bitboard ChessGame::pieceAttacks(PieceType type, int sq) {
+    switch (type) {
+        case KNIGHT: return knightAttacks[sq];
+        case BISHOP: return bishopAttacks(sq, occupied);
+        case ROOK:   return rookAttacks(sq, occupied);
+        case QUEEN:  return queenAttacks(sq, occupied);
+        case KING:   return kingAttacks[sq];
+        default:     return 0;
+    }
+}
+
+void ChessGame::addMoves(int sq, Bitboard targets, MoveList& moves) {
+    while (targets) {
+        int to = popLsb(targets);
+        moves.add(Move(sq, to, (occupied & squareBB(to)) ? CAPTURE : QUIET));
+    }
+}
+
+void ChessGame::addPromotions(int from, int to, int flags, GenType type, MoveList& moves) {
+    bool capture = (flags & CAPTURE) != 0;
+    for (int pt = KNIGHT; pt <= QUEEN; pt++) {
+        bool noisy = capture || pt == QUEEN;
+        if (type == GEN_ALL || noisy == (type == GEN_CAPTURES)) {
+            moves.add(Move(from, to, flags | (pt - KNIGHT)));
+        }
+    }
+}
+
+void ChessGame::generatePawnMoves(GenType type, Bitboard checkMask, Bitboard pinned, MoveList& moves) {
+    Color us = currentPlayer;
+    int king = kingSquare[us];
+    int direction = (us == WHITE) ? -8 : 8;
+    int startRow = (us == WHITE) ? 6 : 1;
+    int promotionRow = (us == WHITE) ? 0 : 7;
+    Bitboard enemy = colorBB[opposite(us)];
+
+    Bitboard pawns = pieceBB[us][PAWN];
+    while (pawns) {
+        int from = popLsb(pawns);
+        Bitboard allowed = checkMask;
+        if (pinned & squareBB(from)) allowed &= lineBB[king][from];
+
+        // Pushes; a double push may block a check the single push does not
+        int forward = from + direction;
+        if (!(occupied & squareBB(forward))) {
+            if (allowed & squareBB(forward)) {
+                if (rowOf(forward) == promotionRow) {
+                    addPromotions(from, forward, PROMOTION, type, moves);
+                } else if (type != GEN_CAPTURES) {
+                    moves.add(Move(from, forward, QUIET));
+                }
+            }
+
+            int doublePush = forward + direction;
+            if (type != GEN_CAPTURES && rowOf(from) == startRow &&
+                !(occupied & squareBB(doublePush)) && (allowed & squareBB(doublePush))) {
+                moves.add(Move(from, doublePush, DOUBLE_PUSH));
+            }
+        }
+
+        // Captures
+        Bitboard captures = pawnAttacks[us][from] & enemy & allowed;
+        while (captures) {
+            int to = popLsb(captures);
+            if (rowOf(to) == promotionRow) {
+                addPromotions(from, to, PROMOTION_CAPTURE, type, moves);
+            } else if (type != GEN_QUIETS) {
+                moves.add(Move(from, to, CAPTURE));
+            }
+        }
+
+        // En passant
+        if (type != GEN_QUIETS && enPassantSquare != -1 &&
+            (pawnAttacks[us][from] & squareBB(enPassantSquare))) {
+            Move move(from, enPassantSquare, EN_PASSANT);
+            if (isLegalMove(move)) moves.add(move);
+        }
+    }
+}
+
+bool ChessGame::isEmpty(int row, int col) {
+    return !(occupied & squareBB(squareOf(row, col)));
+}
+
+void ChessGame::generateCastling(MoveList& moves) {
+    if (currentPlayer == WHITE) {
+        // Kingside castling
+        if ((castlingRights & WHITE_KINGSIDE) && isEmpty(7, 5) && isEmpty(7, 6) &&
+            !isSquareAttacked(7, 5, BLACK) && !isSquareAttacked(7, 6, BLACK)) {
+            moves.add(Move(squareOf(7, 4), squareOf(7, 6), KING_CASTLE));
+        }
+        // Queenside castling
+        if ((castlingRights & WHITE_QUEENSIDE) && isEmpty(7, 1) && isEmpty(7, 2) &&
+            isEmpty(7, 3) && !isSquareAttacked(7, 3, BLACK) &&
+            !isSquareAttacked(7, 2, BLACK)) {
+            moves.add(Move(squareOf(7, 4), squareOf(7, 2), QUEEN_CASTLE));
+        }
+    } else {
+        // Kingside castling
+        if ((castlingRights & BLACK_KINGSIDE) && isEmpty(0, 5) && isEmpty(0, 6) &&
+            !isSquareAttacked(0, 5, WHITE) && !isSquareAttacked(0, 6, WHITE)) {
+            moves.add(Move(squareOf(0, 4), squareOf(0, 6), KING_CASTLE));
+        }
+        // Queenside castling
+        if ((castlingRights & BLACK_QUEENSIDE) && isEmpty(0, 1) && isEmpty(0, 2) &&
+            isEmpty(0, 3) && !isSquareAttacked(0, 3, WHITE) &&
+            !isSquareAttacked(0, 2, WHITE)) {
+            moves.add(Move(squareOf(0, 4), squareOf(0, 2), QUEEN_CASTLE));
+        }
+    }
+}
+
+bool ChessGame::isSquareAttacked(int row, int col, Color attackerColor) {
+    int sq = squareOf(row, col);
+    const Bitboard* attacker = pieceBB[attackerColor];
+
+    // A pawn of ours on sq would attack exactly the squares enemy pawns attack sq from
+    if (pawnAttacks[opposite(attackerColor)][sq] & attacker[PAWN]) return true;
+    if (knightAttacks[sq] & attacker[KNIGHT]) return true;
+    if (kingAttacks[sq] & attacker[KING]) return true;
+    if (bishopAttacks(sq, occupied) & (attacker[BISHOP] | attacker[QUEEN])) return true;
+    if (rookAttacks(sq, occupied) & (attacker[ROOK] | attacker[QUEEN])) return true;
+    return false;
+}
+
+bool ChessGame::isInCheck(Color color) {
+    int kingSq = kingSquare[color];
+    if (kingSq < 0) return false;
+    return isSquareAttacked(rowOf(kingSq), colOf(kingSq), opposite(color));
+}
+
+int ChessGame::enPassantVictim(int to, Color mover) const {
+    return (mover == WHITE) ? to + 8 : to - 8;
+}
+
+bool ChessGame::isLegalMove(const Move& move) {
+    Color mover = currentPlayer;
+    makeMove(move);
+    bool legal = !isInCheck(mover);
+    unmakeMove();
+    return legal;
+}
+
+bool ChessGame::isPseudoLegal(const Move& move) {
+    if (move.isNull()) return false;
+
+    Color us = currentPlayer;
+    int from = move.from(), to = move.to();
+    Piece piece = mailbox[from];
+    if (piece.color != us || (colorBB[us] & squareBB(to))) return false;
+
+    if (move.isCastling()) {
+        if (isInCheck(us)) return false;
+        MoveList castles;
+        generateCastling(castles);
+        for (const Move& castle : castles) {
+            if (castle == move) return true;
+        }
+        return false;
+    }
+
+    if (move.isEnPassant()) {
+        return piece.type == PAWN && to == enPassantSquare &&
+               (pawnAttacks[us][from] & squareBB(to));
+    }
+
+    bool targetIsEnemy = (colorBB[opposite(us)] & squareBB(to)) != 0;
+    if (move.isCapture() != targetIsEnemy) return false;
+
+    if (piece.type == PAWN) {
+        int direction = (us == WHITE) ? -8 : 8;
+        bool lastRow = rowOf(to) == ((us == WHITE) ? 0 : 7);
+        if (move.isPromotion() != lastRow) return false;
+        if (move.isCapture()) return (pawnAttacks[us][from] & squareBB(to)) != 0;
+        if (move.flags() == DOUBLE_PUSH) {
+            return rowOf(from) == ((us == WHITE) ? 6 : 1) && to == from + 2 * direction &&
+                   !(occupied & squareBB(from + direction));
+        }
+        return to == from + direction;
+    }
+
+    if (move.isPromotion() || move.flags() == DOUBLE_PUSH) return false;
+    return (pieceAttacks(piece.type, from) & squareBB(to)) != 0;
+}
+
+bool ChessGame::makeMove(int fromRow, int fromCol, int toRow, int toCol, int promotionPiece) {
+    try {
+        if (!initialized) {
+            LOGE("Game not initialized");
+            return false;
+        }
+
+        std::vector<Move> legalMoves = getLegalMoves(fromRow, fromCol);
+
+        for (const Move& move : legalMoves) {
+            if (move.to() == squareOf(toRow, toCol) &&
+                (!move.isPromotion() || move.promotionType() == promotionPiece)) {
+                // Keep room for a full search line; older entries are dropped
+                if (undoCount >= MAX_UNDO - MAX_PLY) {
+                    int keep = MAX_UNDO / 2;
+                    std::copy(undoStack + undoCount - keep, undoStack + undoCount, undoStack);
+                    undoCount = keep;
+                }
+                makeMove(move);
+                return true;
+            }
+        }
+    } catch (const std::exception& e) {
+        LOGE("Exception in makeMove: %s", e.what());
+    } catch (...) {
+        LOGE("Unknown exception in makeMove");
+    }
+    return false;
+}
+
+void ChessGame::makeMove(const Move& move) {
+    UndoEntry& undo = undoStack[undoCount++];
+    undo.move = move;
+    undo.captured = mailbox[move.to()];
+    undo.castlingRights = castlingRights;
+    undo.enPassantSquare = enPassantSquare;
+    undo.halfMoveClock = halfMoveClock;
+    undo.hash = hash;
+
+    executeMoveInternal(move);
+}
+
+void ChessGame::unmakeMove() {
+    const UndoEntry& undo = undoStack[--undoCount];
+    const Move move = undo.move;
+    int from = move.from(), to = move.to();
+
+    currentPlayer = opposite(currentPlayer);
+    if (currentPlayer == BLACK) fullMoveNumber--;
+
+    // Move the piece back, turning a promoted piece back into a pawn
+    Piece piece = mailbox[to];
+    removePiece(to);
+    if (move.isPromotion()) piece.type = PAWN;
+    putPiece(from, piece);
+
+    if (move.isEnPassant()) {
+        putPiece(enPassantVictim(to, currentPlayer), Piece(PAWN, opposite(currentPlayer)));
+    } else if (undo.captured.type != EMPTY) {
+        putPiece(to, undo.captured);
+    }
+
+    if (move.isCastling()) {
+        int rookFrom = (move.flags() == KING_CASTLE) ? from + 3 : from - 4;
+        int rookTo = (move.flags() == KING_CASTLE) ? from + 1 : from - 1;
+        movePiece(rookTo, rookFrom);
+    }
+
+    castlingRights = undo.castlingRights;
+    enPassantSquare = undo.enPassantSquare;
+    halfMoveClock = undo.halfMoveClock;
+    hash = undo.hash;
+}
+
+void ChessGame::executeMoveInternal(const Move& move) {
+    int from = move.from(), to = move.to();
+    Piece piece = mailbox[from];
+
+    // Handle en passant capture
+    if (move.isEnPassant()) {
+        removePiece(enPassantVictim(to, piece.color));
+    }
+
+    // Handle castling
+    if (move.isCastling()) {
+        int rookFrom = (move.flags() == KING_CASTLE) ? from + 3 : from - 4;
+        int rookTo = (move.flags() == KING_CASTLE) ? from + 1 : from - 1;
+        movePiece(rookFrom, rookTo);
+    }
+
+    // Update en passant; the square is only recorded (and hashed) when an
+    // enemy pawn could actually take, so transpositions hash alike
+    if (enPassantSquare != -1) {
+        hash ^= zobrist.enPassantFile[colOf(enPassantSquare)];
+        enPassantSquare = -1;
+    }
+    if (move.flags() == DOUBLE_PUSH) {
+        int passed = (from + to) / 2;
+        if (pawnAttacks[piece.color][passed] & pieceBB[opposite(piece.color)][PAWN]) {
+            enPassantSquare = passed;
+            hash ^= zobrist.enPassantFile[colOf(passed)];
+        }
+    }
+
+    // Update half-move clock
+    if (piece.type == PAWN || move.isCapture()) {
+        halfMoveClock = 0;
+    } else {
+        halfMoveClock++;
+    }
+
+    // Move piece, handling promotion
+    if (move.isPromotion()) {
+        piece.type = move.promotionType();
+    }
+    removePiece(from);
+    removePiece(to);
+    putPiece(to, piece);
+
+    // Moving the king or a rook, or capturing a rook, loses castling rights
+    hash ^= zobrist.castling[castlingRights];
+    castlingRights &= castlingRightsKept(from) & castlingRightsKept(to);
+    hash ^= zobrist.castling[castlingRights];
+
+    // Update move counter
+    if (currentPlayer == BLACK) fullMoveNumber++;
+
+    // Switch player
+    currentPlayer = opposite(currentPlayer);
+    hash ^= zobrist.blackToMove;
+}
+
+// Tapered between the middlegame and endgame scores by the material left
+int ChessGame::evaluateBoard() {
+    PawnEntry uncached;
+    if (!pawnTable) evaluatePawns(pawnKey, pieceBB[WHITE][PAWN], pieceBB[BLACK][PAWN], uncached);
+    const PawnEntry& pawns =
+        pawnTable ? pawnTable->probe(pawnKey, pieceBB[WHITE][PAWN], pieceBB[BLACK][PAWN]) : uncached;
+    int mg = mgScore + pawns.mg;
+    int eg = egScore + pawns.eg;
+    scorePassedPawns(pawns, occupied, mg, eg);
+
+    int phase = std::min(gamePhase, MAX_PHASE);
+    return (mg * phase + eg * (MAX_PHASE - phase)) / MAX_PHASE;
+}
+
+int ChessGame::scoreMoveOrdering(const Move& move) {
+    int score = 0;
+
+    if (move.isCapture()) {
+        PieceType victim = move.isEnPassant() ? PAWN : mailbox[move.to()].type;
+        PieceType attacker = mailbox[move.from()].type;
+        score = 10 * pieceValues[victim] - pieceValues[attacker];
+    }
+
+    if (move.isPromotion()) score += (move.promotionType() == QUEEN) ? 800 : -800;
+
+    int toRow = rowOf(move.to()), toCol = colOf(move.to());
+    if (toRow >= 3 && toRow <= 4 && toCol >= 3 && toCol <= 4) {
+        score += 20;
+    }
+
+    return score;
+}
+
+int ChessGame::staticExchange(const Move& move) {
+    int from = move.from(), to = move.to();
+    Color side = mailbox[from].color;
+    PieceType attacker = mailbox[from].type;
+    Bitboard occ = occupied ^ squareBB(from);
+
+    // gain[d]: what the side making capture d nets if the exchange ends there
+    int gain[32];
+    int d = 0;
+    gain[0] = move.isEnPassant() ? pieceValues[PAWN] : pieceValues[mailbox[to].type];
+    if (move.isEnPassant()) occ ^= squareBB(enPassantVictim(to, side));
+    if (move.isPromotion()) {
+        attacker = move.promotionType();
+        gain[0] += pieceValues[attacker] - pieceValues[PAWN];
+    }
+
+    Bitboard diagonal = pieceBB[WHITE][BISHOP] | pieceBB[BLACK][BISHOP] |
+                        pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN];
+    Bitboard straight = pieceBB[WHITE][ROOK] | pieceBB[BLACK][ROOK] |
+                        pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN];
+    Bitboard attackers = attackersTo(to, occ) & occ;
+
+    while (d < 31) {
+        side = opposite(side);
+        Bitboard ours = attackers & colorBB[side];
+        if (!ours) break;
+
+        int type = PAWN;
+        while (!(ours & pieceBB[side][type])) type++;
+
+        // The king may only take last
+        if (type == KING && (attackers & colorBB[opposite(side)])) break;
+
+        d++;
+        gain[d] = pieceValues[attacker] - gain[d - 1];
+        if (std::max(-gain[d - 1], gain[d]) < 0) break;
+
+        // Moving the piece off the square can uncover a slider behind it
+        occ ^= squareBB(lsb(ours & pieceBB[side][type]));
+        if (type == PAWN || type == BISHOP || type == QUEEN) attackers |= bishopAttacks(to, occ) & diagonal;
+        if (type == ROOK || type == QUEEN) attackers |= rookAttacks(to, occ) & straight;
+        attackers &= occ;
+        attacker = static_cast<PieceType>(type);
+    }
+
+    // Each side declines a recapture that would leave it worse off
+    while (d > 0) {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        d--;
+    }
+    return gain[0];
+}
+
+void ChessGame::setNetwork(const NnueNetwork* net) {
+    network = (net && net->isLoaded()) ? net : nullptr;
+    if (network) network->refresh(accumulator, mailbox);
+}
+
+int ChessGame::evaluate() {
+    if (network) {
+        // Never let the network's output pass for a mate score
+        int score = network->evaluate(accumulator, currentPlayer);
+        return std::max(-MATE_BOUND + 1, std::min(score, MATE_BOUND - 1));
+    }
+    int score = evaluateBoard();
+    return (currentPlayer == WHITE) ? score : -score;
+}
+
+// Late move reductions by depth and move number: logarithmic in both, so
+// the reduction grows slowly the deeper and later a move is searched
+static int lmrReductions[MAX_SEARCH_DEPTH + 1][MAX_MOVES];
+
+static bool initReductions() {
+    for (int depth = 1; depth <= MAX_SEARCH_DEPTH; depth++) {
+        for (int count = 1; count < MAX_MOVES; count++) {
+            lmrReductions[depth][count] = static_cast<int>(0.75 + std::log(depth) * std::log(count) / 2.25);
+        }
+    }
+    return true;
+}
+
+static const bool reductionsReady = initReductions();
+
+// Largest positional gain a quiet move is assumed to make at the last plies
+static const int futilityMargin[3] = {0, 200, 350};
+
+void ChessGame::makeNullMove() {
+    UndoEntry& undo = undoStack[undoCount++];
+    undo.move = Move::none();
+    undo.captured = Piece();
+    undo.castlingRights = castlingRights;
+    undo.enPassantSquare = enPassantSquare;
+    undo.halfMoveClock = halfMoveClock;
+    undo.hash = hash;
+
+    if (enPassantSquare != -1) {
+        hash ^= zobrist.enPassantFile[colOf(enPassantSquare)];
+        enPassantSquare = -1;
+    }
+    halfMoveClock++;
+    currentPlayer = opposite(currentPlayer);
+    hash ^= zobrist.blackToMove;
+}
+
+void ChessGame::unmakeNullMove() {
+    const UndoEntry& undo = undoStack[--undoCount];
+    currentPlayer = opposite(currentPlayer);
+    enPassantSquare = undo.enPassantSquare;
+    halfMoveClock = undo.halfMoveClock;
+    hash = undo.hash;
+}
+
+// History scores stay within +-MAX_HISTORY: each update moves a score
+// toward the bound by a fraction of the distance left
+static const int MAX_HISTORY = 16384;
+
+static void updateHistory(int& entry, int bonus) {
+    entry += bonus - entry * std::abs(bonus) / MAX_HISTORY;
+}
+
+void ChessGame::clearMoveOrdering() {
+    std::fill(&killers[0][0], &killers[0][0] + MAX_PLY * 2, Move::none());
+    std::fill(&counterMoves[0][0], &counterMoves[0][0] + 64 * 64, Move::none());
+    std::fill(&history[0][0][0], &history[0][0][0] + 3 * 64 * 64, 0);
+}
+
+void ChessGame::updateQuietStats(const Move& move, int ply, int depth, const Move* tried, int triedCount) {
+    if (killers[ply][0] != move) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+
+    if (undoCount > 0 && !undoStack[undoCount - 1].move.isNull()) {
+        const Move previous = undoStack[undoCount - 1].move;
+        counterMoves[previous.from()][previous.to()] = move;
+    }
+
+    int bonus = std::min(depth * depth, 400) * 16;
+    updateHistory(history[currentPlayer][move.from()][move.to()], bonus);
+    for (int i = 0; i < triedCount; i++) {
+        updateHistory(history[currentPlayer][tried[i].from()][tried[i].to()], -bonus);
+    }
+}
+
+bool ChessGame::hasNonPawnMaterial() const {
+    return (colorBB[currentPlayer] & ~pieceBB[currentPlayer][PAWN] & ~pieceBB[currentPlayer][KING]) != 0;
+}
+
+bool ChessGame::isDrawByRule() const {
+    if (halfMoveClock >= 100) return true;
+    for (int i = undoCount - 2; i >= undoCount - halfMoveClock && i >= 0; i -= 2) {
+        if (undoStack[i + 1].move.isNull() || undoStack[i].move.isNull()) break;
+        if (undoStack[i].hash == hash) return true;
+    }
+    return false;
+}
+
+bool ChessGame::givesCheck(const Move& move) const {
+    Color us = currentPlayer;
+    int from = move.from();
+    int to = move.to();
+    int theirKing = kingSquare[opposite(us)];
+    Bitboard king = squareBB(theirKing);
+    PieceType type = move.isPromotion() ? move.promotionType() : mailbox[from].type;
+
+    // The board after the move, for our sliders: the moved piece checking
+    // from its new square or uncovering one that does
+    Bitboard occ = (occupied ^ squareBB(from)) | squareBB(to);
+    Bitboard bishops = (pieceBB[us][BISHOP] | pieceBB[us][QUEEN]) & ~squareBB(from);
+    Bitboard rooks = (pieceBB[us][ROOK] | pieceBB[us][QUEEN]) & ~squareBB(from);
+    if (type == BISHOP || type == QUEEN) bishops |= squareBB(to);
+    if (type == ROOK || type == QUEEN) rooks |= squareBB(to);
+    if (move.isEnPassant()) occ ^= squareBB(enPassantVictim(to, us));
+    if (move.isCastling()) {
+        int rookFrom = (move.flags() == KING_CASTLE) ? from + 3 : from - 4;
+        int rookTo = (move.flags() == KING_CASTLE) ? from + 1 : from - 1;
+        occ ^= squareBB(rookFrom) | squareBB(rookTo);
+        rooks ^= squareBB(rookFrom) | squareBB(rookTo);
+    }
+
+    if (type == PAWN && (pawnAttacks[us][to] & king)) return true;
+    if (type == KNIGHT && (knightAttacks[to] & king)) return true;
+    return (bishopAttacks(theirKing, occ) & bishops) || (rookAttacks(theirKing, occ) & rooks);
+}
+
+// Negamax principal variation search. The first move is searched with the
+// full window; the rest get a null window that only proves them worse, and
+// are searched again in full when that proof fails.
+int ChessGame::search(int depth, int ply, int alpha, int beta) {
+    if ((++nodes & 1023) == 0) checkTime();
+    if (stopped) return 0;
+
+    // Repeating the position or running out the clock scores nothing,
+    // inside the tables' coverage and out
+    if (isDrawByRule()) return 0;
+
+    if (depth <= 0) return quiescence(ply, alpha, beta);
+    selDepth = std::max(selDepth, ply);
+
+    // Nothing left to search where the tables know the outcome
+    int tableScore;
+    if (probeTablebases(ply, tableScore)) return tableScore;
+
+    bool pvNode = beta - alpha > 1;
+
+    // A stored result from at least this depth can settle the node outright
+    Move ttMove = Move::none();
+    TTHit hit;
+    if (tt) SEARCH_STAT(ttProbes);
+    if (tt && tt->probe(hash, ply, hit)) {
+        SEARCH_STAT(ttHits);
+        ttMove = hit.move;
+        if (!pvNode && hit.depth >= depth) {
+            if (hit.bound == BOUND_EXACT) return hit.score;
+            if (hit.bound == BOUND_LOWER && hit.score >= beta) return hit.score;
+            if (hit.bound == BOUND_UPPER && hit.score <= alpha) return hit.score;
+        }
+    }
+
+    bool inCheck = isInCheck(currentPlayer);
+    int staticEval = inCheck ? -INFINITE_SCORE : evaluate();
+    bool mateWindow = std::abs(beta) >= MATE_BOUND;
+
+    // Reverse futility: this far ahead this close to the horizon, the
+    // opponent is not going to catch up
+    if (options.reverseFutility && !pvNode && !inCheck && !mateWindow && depth <= 4 &&
+        staticEval - 120 * depth >= beta) {
+        return staticEval;
+    }
+
+    // Null move: if passing still fails high a reduced search, a real move
+    // will too. Not in check, not twice in a row, and only with pieces on
+    // the board, as king and pawn endings are where zugzwang lives.
+    bool afterNullMove = undoCount > 0 && undoStack[undoCount - 1].move.isNull();
+    if (options.nullMove && !pvNode && !inCheck && !mateWindow && !afterNullMove && depth >= 3 &&
+        staticEval >= beta && hasNonPawnMaterial()) {
+        int reduction = 3 + depth / 6;
+        makeNullMove();
+        int score = -search(depth - 1 - reduction, ply + 1, -beta, -beta + 1);
+        unmakeNullMove();
+        if (stopped) return 0;
+        if (score >= beta) return score >= MATE_BOUND ? beta : score;
+    }
+
+    // Quiet moves that cannot lift the score to alpha are not searched
+    bool futilityPruning = options.futility && !pvNode && !inCheck && depth <= 2 &&
+                           std::abs(alpha) < MATE_BOUND && staticEval + futilityMargin[depth] <= alpha;
+
+    Move counterMove = Move::none();
+    if (undoCount > 0 && !undoStack[undoCount - 1].move.isNull()) {
+        const Move previous = undoStack[undoCount - 1].move;
+        counterMove = counterMoves[previous.from()][previous.to()];
+    }
+
+    MovePicker picker(*this, ttMove, killers[ply], counterMove);
+    Move bestMove = Move::none();
+    int bestScore = -INFINITE_SCORE;
+    int moveCount = 0;
+    bool raisedAlpha = false;
+
+    // Quiet moves searched so far, penalised if a later one cuts off
+    Move quietsTried[64];
+    int quietCount = 0;
+
+    for (Move move = picker.next(); !move.isNull(); move = picker.next()) {
+        bool quiet = !move.isCapture() && !move.isPromotion();
+        moveCount++;
+        bool checking = givesCheck(move);
+
+        if (futilityPruning && quiet && !checking && moveCount > 1) {
+            bestScore = std::max(bestScore, staticEval + futilityMargin[depth]);
+            continue;
+        }
+
+        makeMove(move);
+
+        int score;
+        if (moveCount == 1) {
+            score = -search(depth - 1, ply + 1, -beta, -alpha);
+        } else {
+            // Late quiet moves rarely matter: search them shallower first,
+            // and at full depth only if they unexpectedly beat alpha
+            int reduction = 0;
+            if (options.lateMoveReductions && depth >= 3 && moveCount > (pvNode ? 5 : 3) &&
+                quiet && !inCheck && !checking) {
+                reduction = lmrReductions[std::min(depth, MAX_SEARCH_DEPTH)][std::min(moveCount, MAX_MOVES - 1)];
+                if (pvNode) reduction--;
+                reduction = std::max(0, std::min(reduction, depth - 2));
+            }
+
+            score = -search(depth - 1 - reduction, ply + 1, -alpha - 1, -alpha);
+            if (reduction > 0 && score > alpha) {
+                score = -search(depth - 1, ply + 1, -alpha - 1, -alpha);
+            }
+            if (score > alpha && score < beta) {
+                score = -search(depth - 1, ply + 1, -beta, -alpha);
+            }
+        }
+        unmakeMove();
+        if (stopped) return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                bestMove = move;
+                alpha = score;
+                raisedAlpha = true;
+                if (alpha >= beta) {
+                    SEARCH_STAT(cutoffs);
+                    if (moveCount == 1) SEARCH_STAT(firstMoveCutoffs);
+                    if (quiet) updateQuietStats(move, ply, depth, quietsTried, quietCount);
+                    break;
+                }
+            }
+        }
+        if (quiet && quietCount < 64) quietsTried[quietCount++] = move;
+    }
+
+    if (moveCount == 0) return inCheck ? -(MATE_SCORE - ply) : 0;
+
+    if (tt) {
+        Bound bound = (bestScore >= beta) ? BOUND_LOWER : raisedAlpha ? BOUND_EXACT : BOUND_UPPER;
+        tt->store(hash, ply, bestMove, bestScore, depth, bound);
+    }
+    return bestScore;
+}
+
+// Allowance for positional gain on top of the captured piece's value
+static const int DELTA_MARGIN = 200;
+
+// The side to move may stand pat on the static evaluation instead of
+// capturing, except in check, where every evasion is searched and having
+// none is mate. Captures that cannot lift the score to alpha even for free,
+// or that lose material on exchange, are skipped.
+int ChessGame::quiescence(int ply, int alpha, int beta) {
+    if ((++nodes & 1023) == 0) checkTime();
+    if (stopped) return 0;
+    selDepth = std::max(selDepth, ply);
+
+    MovePicker picker(*this, Move::none(), nullptr, Move::none(), true);
+    bool inCheck = picker.inCheck();
+    int standPat = inCheck ? -INFINITE_SCORE : evaluate();
+    if (ply >= MAX_PLY - 1) return inCheck ? evaluate() : standPat;
+
+    int bestScore = standPat;
+    if (bestScore >= beta) return bestScore;
+    alpha = std::max(alpha, bestScore);
+
+    int moveCount = 0;
+    for (Move move = picker.next(); !move.isNull(); move = picker.next()) {
+        moveCount++;
+        if (!inCheck && !move.isPromotion()) {
+            PieceType victim = move.isEnPassant() ? PAWN : mailbox[move.to()].type;
+            if (standPat + pieceValues[victim] + DELTA_MARGIN <= alpha) continue;
+            if (staticExchange(move) < 0) continue;
+        }
+
+        makeMove(move);
+        int score = -quiescence(ply + 1, -beta, -alpha);
+        unmakeMove();
+        if (stopped) return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) break;
+            }
+        }
+    }
+
+    if (inCheck && moveCount == 0) return -(MATE_SCORE - ply);
+    return bestScore;
+}
+
+// Budgets rather than depths, so a level costs about the same in every
+// position. Margins are about what a player of the level misjudges: a
+// beginner may give up a pawn or two, a club player a small edge.
+SearchLimits SearchLimits::forDifficulty(int difficulty) {
+    SearchLimits limits;
+    switch (difficulty) {
+        case 1:
+            limits.maxNodes = 2000;
+            limits.timeMs = 300;
+            limits.multiPV = 4;
+            limits.multiPVMargin = 200;
+            break;
+        case 2:
+            limits.maxNodes = 8000;
+            limits.timeMs = 600;
+            limits.multiPV = 3;
+            limits.multiPVMargin = 80;
+            break;
+        case 3:
+            limits.maxNodes = 40000;
+            limits.timeMs = 1500;
+            limits.multiPV = 2;
+            limits.multiPVMargin = 15;
+            break;
+        default:
+            limits.timeMs = 3000;
+            break;
+    }
+    return limits;
+}
+
+// The clock and the node budget never cut depth 1 short, so there is
+// always a searched move; an explicit stop is honoured at once. The budget
+// holds while pondering too, as it is what makes the level weak.
+void ChessGame::checkTime() {
+    if (nodeCounter) nodeCounter->fetch_add(1024, std::memory_order_relaxed);
+    if (stopSignal && stopSignal->load(std::memory_order_relaxed)) {
+        stopped = true;
+    } else if (nodeLimit && rootDepth > 1 && nodes >= nodeLimit) {
+        stopped = true;
+    } else if (pondering()) {
+        if (rootDepth > 1 && elapsedMs() >= MAX_PONDER_MS) stopped = true;
+    } else if (hasDeadline && rootDepth > 1 && std::chrono::steady_clock::now() >= searchDeadline) {
+        stopped = true;
+    }
+}
+
+int ChessGame::elapsedMs() const {
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - searchStart).count());
+}
+
+// PVS over the root moves. With a margin, every move that scores within it
+// of the best so far is searched exactly and keeps its score in
+// rootMoves.scores; the rest only have to be proven out of reach and score
+// -INFINITE_SCORE. Returns the best score, a bound when outside (alpha,
+// beta).
+int ChessGame::searchRoot(MoveList& rootMoves, int depth, int alpha, int beta, int margin, Move& bestMove) {
+    rootDepth = depth;
+
+    int bestScore = -INFINITE_SCORE;
+    for (int i = 0; i < rootMoves.size(); i++) {
+        const Move move = rootMoves[i];
+        int lower = (i == 0) ? alpha : std::max(alpha, bestScore - margin);
+        rootMoves.scores[i] = -INFINITE_SCORE;
+
+        makeMove(move);
+        int score;
+        if (i == 0) {
+            score = -search(depth - 1, 1, -beta, -alpha);
+        } else {
+            score = -search(depth - 1, 1, -lower - 1, -lower);
+            if (score > lower && score < beta) {
+                score = -search(depth - 1, 1, -beta, -lower);
+            }
+        }
+        unmakeMove();
+        if (stopped) return 0;
+
+        if (i > 0 && score <= lower) continue;
+
+        rootMoves.scores[i] = score;
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+        }
+        if (score >= beta) return score;
+    }
+    return bestScore;
+}
+
+// Weighted by how close each move comes to the best, so the best is the
+// likeliest and one at the edge of the margin rarely played. A mate, for
+// or against, is never traded for a move outside it.
+Move ChessGame::pickAmongBest(MoveList scoredMoves, int bestScore, int multiPV, int margin) {
+    scoredMoves.sortByScore();
+    if (std::abs(bestScore) >= MATE_BOUND) return scoredMoves[0];
+
+    int weights[MAX_MOVES];
+    int candidates = 0;
+    int total = 0;
+    while (candidates < std::min(multiPV, scoredMoves.size()) &&
+           scoredMoves.scores[candidates] >= bestScore - margin) {
+        weights[candidates] = margin + 1 - (bestScore - scoredMoves.scores[candidates]);
+        total += weights[candidates];
+        candidates++;
+    }
+    if (candidates <= 1) return scoredMoves[0];
+
+    int pick = random->getBelow(total);
+    for (int i = 0; i < candidates; i++) {
+        pick -= weights[i];
+        if (pick < 0) return scoredMoves[i];
+    }
+    return scoredMoves[0];
+}
+
+void ChessGame::principalVariation(const Move& bestMove, int depth, SearchInfo& info) {
+    info.pvLength = 0;
+    Move move = bestMove;
+    while (!move.isNull() && info.pvLength < std::min(depth, MAX_PLY)) {
+        info.pv[info.pvLength++] = move;
+        makeMove(move);
+
+        // A repetition would go round forever
+        bool repeated = false;
+        for (int i = undoCount - 2; i >= undoCount - info.pvLength && i >= 0; i--) {
+            if (undoStack[i].hash == hash) repeated = true;
+        }
+
+        TTHit hit;
+        move = Move::none();
+        if (!repeated && tt && tt->probe(hash, 0, hit) && isPseudoLegal(hit.move) && isLegalMove(hit.move)) {
+            move = hit.move;
+        }
+    }
+    for (int i = 0; i < info.pvLength; i++) unmakeMove();
+}
+
+Move ChessGame::getBestMove(const SearchLimits& limits, int threadIndex) {
+    // Helper threads only fill the shared table; the move choice and the
+    // table's generation belong to the main search
+    bool mainThread = threadIndex == 0;
+    bool chooseAmongBest = mainThread && random && limits.multiPV > 1 && limits.multiPVMargin > 0;
+    int margin = chooseAmongBest ? limits.multiPVMargin : 0;
+
+    try {
+        MoveList allMoves;
+        generateLegalMoves(allMoves);
+
+        if (allMoves.empty()) {
+            return Move::none();
+        }
+
+        Move tableMove;
+        if (tablebaseRootMove(allMoves, tableMove)) {
+            if (mainThread) LOGD("Tablebase move %s", moveToString(tableMove).c_str());
+            return tableMove;
+        }
+
+        searchStart = std::chrono::steady_clock::now();
+        searchDeadline = searchStart + std::chrono::milliseconds(limits.timeMs);
+        hasDeadline = limits.timeMs > 0;
+        nodeLimit = limits.maxNodes;
+        stopped = false;
+        nodes = 0;
+        stats = SearchStats();
+        clearMoveOrdering();
+
+        // Score and sort moves, trying the stored best move first
+        Move bestMove = Move::none();
+        TTHit hit;
+        if (tt) {
+            if (mainThread) tt->newSearch();
+            if (tt->probe(hash, 0, hit)) bestMove = hit.move;
+        }
+
+        int maxDepth = std::max(1, std::min(limits.maxDepth, MAX_SEARCH_DEPTH));
+        int completedDepth = 0;
+        int previousScore = 0;
+
+        // The last completed iteration's root scores, to choose from
+        MoveList scoredMoves;
+        for (int depth = 1; depth <= maxDepth; depth++) {
+            // Half the helpers run one ply ahead so threads spread over
+            // different depths rather than duplicate each other
+            int iterationDepth = std::min(depth + (threadIndex & 1), maxDepth);
+
+            // The previous iteration's choice is searched first
+            for (int i = 0; i < allMoves.size(); i++) {
+                allMoves.scores[i] = (allMoves[i] == bestMove) ? std::numeric_limits<int>::max()
+                                                               : scoreMoveOrdering(allMoves[i]);
+            }
+            allMoves.sortByScore();
+
+            // Helpers also start from a different root move each
+            if (!mainThread) {
+                std::rotate(allMoves.begin(), allMoves.begin() + threadIndex % allMoves.size(), allMoves.end());
+            }
+
+            // Aspiration window around the last score, widened on whichever
+            // side the result falls outside. Choosing among several moves
+            // needs their exact scores, so that search keeps a full window.
+            int delta = ASPIRATION_WINDOW;
+            int alpha = -INFINITE_SCORE, beta = INFINITE_SCORE;
+            if (!chooseAmongBest && iterationDepth >= 4 && std::abs(previousScore) < MATE_BOUND) {
+                alpha = std::max(previousScore - delta, -INFINITE_SCORE);
+                beta = std::min(previousScore + delta, INFINITE_SCORE);
+            }
+
+            Move iterationBest = allMoves[0];
+            selDepth = 0;
+            int score;
+            while (true) {
+                score = searchRoot(allMoves, iterationDepth, alpha, beta, margin, iterationBest);
+                if (stopped) break;
+
+                if (score <= alpha) {
+                    alpha = std::max(score - delta, -INFINITE_SCORE);
+                } else if (score >= beta) {
+                    beta = std::min(score + delta, INFINITE_SCORE);
+                } else {
+                    break;
+                }
+                delta *= 2;
+            }
+            if (stopped) break;
+
+            bestMove = iterationBest;
+            previousScore = score;
+            completedDepth = iterationDepth;
+            if (chooseAmongBest) scoredMoves = allMoves;
+
+            if (mainThread && infoListener) {
+                SearchInfo info;
+                info.depth = iterationDepth;
+                info.selDepth = selDepth;
+                info.score = score;
+                info.timeMs = elapsedMs();
+                info.nodes = nodes;
+                info.hashfull = tt ? tt->hashfull() : 0;
+                info.stats = stats;
+                principalVariation(bestMove, iterationDepth, info);
+                infoListener(info);
+            }
+
+            // Deeper iterations cannot improve on a forced mate
+            if (score > MATE_BOUND) break;
+
+            // An iteration takes several times the last one; don't start
+            // one that cannot finish. Helpers keep going until stopped.
+            if (mainThread && hasDeadline && !pondering() && elapsedMs() * 2 > limits.timeMs) break;
+            if (mainThread && nodeLimit && nodes * 2 > nodeLimit) break;
+        }
+
+        // Stopped before depth 1 finished: fall back on move ordering alone
+        if (completedDepth == 0) bestMove = allMoves[0];
+        Move played = bestMove;
+        if (chooseAmongBest && completedDepth > 0) {
+            played = pickAmongBest(scoredMoves, previousScore, limits.multiPV, margin);
+        }
+
+        if (mainThread) LOGD("Search finished: depth %d, %llu nodes in %d ms", completedDepth,
+             static_cast<unsigned long long>(nodes), elapsedMs());
+        return played;
+    } catch (const std::exception& e) {
+        LOGE("Exception in getBestMove: %s", e.what());
+        return Move::none();
+    } catch (...) {
+        LOGE("Unknown exception in getBestMove");
+        return Move::none();
+    }
+}
+
+// Castling rights and en passant captures are not in the tables' index
+bool ChessGame::probeTablebases(int ply, int& score) {
+    if (!tablebases || castlingRights || enPassantSquare != -1 ||
+        popCount(occupied) > tablebases->getPieceLimit()) {
+        return false;
+    }
+
+    TbResult result;
+    if (!tablebases->probe(mailbox, currentPlayer, result)) return false;
+
+    int distance = std::min(ply + result.plies, MAX_PLY - 1);
+    score = result.wdl > 0 ? MATE_SCORE - distance : result.wdl < 0 ? -(MATE_SCORE - distance) : 0;
+    return true;
+}
+
+// Fastest win, else a draw, else the slowest loss
+bool ChessGame::tablebaseRootMove(MoveList& rootMoves, Move& bestMove) {
+    int rootScore;
+    if (!probeTablebases(0, rootScore)) return false;
+
+    int bestScore = -INFINITE_SCORE;
+    for (const Move& move : rootMoves) {
+        makeMove(move);
+        int score;
+        bool covered = probeTablebases(1, score);
+        unmakeMove();
+        if (!covered) return false;
+
+        if (-score > bestScore) {
+            bestScore = -score;
+            bestMove = move;
+        }
+    }
+    return true;
+}
+
+Move ChessGame::expectedReply() {
+    TTHit hit;
+    if (!tt || !tt->probe(hash, 0, hit) || hit.move.isNull()) return Move::none();
+    if (!isPseudoLegal(hit.move) || !isLegalMove(hit.move)) return Move::none();
+    return hit.move;
+}
+
+int ChessGame::getCurrentPlayer() {
+    return currentPlayer;
+}
+
+bool ChessGame::isGameOver() {
+    MoveList moves;
+    generateLegalMoves(moves);
+    return moves.empty();
+}
+
+// Initialize static members
+const int ChessGame::pawnTableWhite[8][8] = {
+    {0,   0,   0,   0,   0,   0,   0,   0},
+    {50,  50,  50,  50,  50,  50,  50,  50},
+    {10,  10,  20,  30,  30,  20,  10,  10},
+    {5,   5,   10,  27,  27,  10,  5,   5},
+    {0,   0,   0,   25,  25,  0,   0,   0},
+    {5,   -5,  -10, 0,   0,   -10, -5,  5},
+    {5,   10,  10,  -25, -25, 10,  10,  5},
+    {0,   0,   0,   0,   0,   0,   0,   0}
+};
+
+const int ChessGame::knightTable[8][8] = {
+    {-50, -40, -30, -30, -30, -30, -40, -50},
+    {-40, -20, 0,   5,   5,   0,   -20, -40},
+    {-30, 5,   10,  15,  15,  10,  5,   -30},
+    {-30, 0,   15,  20,  20,  15,  0,   -30},
+    {-30, 5,   15,  20,  20,  15,  5,   -30},
+    {-30, 0,   10,  15,  15,  10,  0,   -30},
+    {-40, -20, 0,   0,   0,   0,   -20, -40},
+    {-50, -40, -20, -30, -30, -20, -40, -50}
+};
+
+const int ChessGame::bishopTable[8][8] = {
+    {-20, -10, -10, -10, -10, -10, -10, -20},
+    {-10, 5,   0,   0,   0,   0,   5,   -10},
+    {-10, 10,  10,  10,  10,  10,  10,  -10},
+    {-10, 0,   10,  10,  10,  10,  0,   -10},
+    {-10, 5,   5,   10,  10,  5,   5,   -10},
+    {-10, 0,   5,   10,  10,  5,   0,   -10},
+    {-10, 0,   0,   0,   0,   0,   0,   -10},
+    {-20, -10, -40, -10, -10, -40, -10, -20}
+};
+
+const int ChessGame::rookTable[8][8] = {
+    {0,  0,  0,  5,  5,  0,  0,  0},
+    {-5, 0,  0,  0,  0,  0,  0,  -5},
+    {-5, 0,  0,  0,  0,  0,  0,  -5},
+    {-5, 0,  0,  0,  0,  0,  0,  -5},
+    {-5, 0,  0,  0,  0,  0,  0,  -5},
+    {-5, 0,  0,  0,  0,  0,  0,  -5},
+    {5,  10, 10, 10, 10, 10, 10, 5},
+    {0,  0,  0,  0,  0,  0,  0,  0}
+};
+
+const int ChessGame::queenTable[8][8] = {
+    {-20, -10, -10, -5, -5, -10, -10, -20},
+    {-10, 0,   5,   0,  0,  0,   0,   -10},
+    {-10, 5,   5,   5,  5,  5,   0,   -10},
+    {0,   0,   5,   5,  5,  5,   0,   -5},
+    {-5,  0,   5,   5,  5,  5,   0,   -5},
+    {-10, 0,   5,   5,  5,  5,   0,   -10},
+    {-10, 0,   0,   0,  0,  0,   0,   -10},
+    {-20, -10, -10, -5, -5, -10, -10, -20}
+};
+
+const int ChessGame::kingTableMiddle[8][8] = {
+    {-30, -40, -40, -50, -50, -40, -40, -30},
+    {-30, -40, -40, -50, -50, -40, -40, -30},
+    {-30, -40, -40, -50, -50, -40, -40, -30},
+    {-30, -40, -40, -50, -50, -40, -40, -30},
+    {-20, -30, -30, -40, -40, -30, -30, -20},
+    {-10, -20, -20, -20, -20, -20, -20, -10},
+    {20,  20,  0,   0,   0,   0,   20,  20},
+    {20,  30,  10,  0,   0,   10,  30,  20}
+};
+
+const int ChessGame::kingTableEnd[8][8] = {
+    {-50, -30, -30, -30, -30, -30, -30, -50},
+    {-30, -30, 0,   0,   0,   0,   -30, -30},
+    {-30, -10, 20,  30,  30,  20,  -10, -30},
+    {-30, -10, 30,  40,  40,  30,  -10, -30},
+    {-30, -10, 30,  40,  40,  30,  -10, -30},
+    {-30, -10, 20,  30,  30,  20,  -10, -30},
+    {-30, -20, -10, 0,   0,   -10, -20, -30},
+    {-50, -40, -30, -20, -20, -30, -40, -50}
+};
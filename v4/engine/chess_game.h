@@ -0,0 +1,415 @@
+// Game state, legal move generation, make/unmake, evaluation and search
+#ifndef CHECKMATE_ENGINE_CHESS_GAME_H
+#define CHECKMATE_ENGINE_CHESS_GAME_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "bitboard.h"
+#include "nnue.h"
+#include "pawns.h"
+#include "random.h"
+#include "search_info.h"
+#include "tablebase.h"
+#include "tt.h"
+#include "types.h"
+
+// State that makeMove overwrites and unmakeMove has to put back
+struct UndoEntry {
+    Move move;
+    Piece captured;
+    int castlingRights;
+    int enPassantSquare;
+    int halfMoveClock;
+    uint64_t hash;
+};
+
+// Deepest iteration getBestMove will start
+const int MAX_SEARCH_DEPTH = 64;
+
+// Longest a ponder search keeps the CPU busy waiting for the opponent
+const int MAX_PONDER_MS = 30000;
+
+// How far and how long getBestMove may think. A time of zero means no
+// clock and a node budget of zero no budget; the search then stops only
+// at maxDepth.
+struct SearchLimits {
+    int maxDepth = MAX_SEARCH_DEPTH;
+    int timeMs = 0;
+    uint64_t maxNodes = 0;
+
+    // With a random source attached, the move is drawn from the multiPV best
+    // root moves scoring within multiPVMargin centipawns of the best, the
+    // closer the likelier. One plays the best move.
+    int multiPV = 1;
+    int multiPVMargin = 0;
+
+    // The app's levels: node budgets and a choice among near-best moves for
+    // the easy levels, full searches on a clock for the strong ones
+    static SearchLimits forDifficulty(int difficulty);
+};
+
+// Selective search techniques, all on by default. Turning one off makes
+// the search plain alpha-beta in that respect, for testing and comparison.
+struct SearchOptions {
+    bool nullMove = true;
+    bool lateMoveReductions = true;
+    bool futility = true;
+    bool reverseFutility = true;
+};
+
+class ChessGame {
+private:
+    // Position: one bitboard per color and piece type, per-color and total
+    // occupancy, and a square-indexed mailbox for O(1) piece lookup.
+    Bitboard pieceBB[3][7];
+    Bitboard colorBB[3];
+    Bitboard occupied;
+    Piece mailbox[64];
+    int kingSquare[3];
+    Color currentPlayer;
+    int castlingRights;
+    int enPassantSquare;
+    int halfMoveClock;
+    int fullMoveNumber;
+    bool initialized;
+
+    // Zobrist key of the current position, kept up to date move by move
+    uint64_t hash;
+
+    // Zobrist key of the pawns alone, for the pawn structure cache
+    uint64_t pawnKey;
+
+    // Material plus piece-square scores from White's point of view, for
+    // the middlegame and the endgame, and the game phase that blends them.
+    // Updated with every piece placed or removed, like the hash.
+    int mgScore;
+    int egScore;
+    int gamePhase;
+
+    // Evaluation network, owned by the caller; null evaluates with the
+    // piece-square tables. Its accumulator is updated the same way.
+    const NnueNetwork* network;
+    NnueAccumulator accumulator;
+
+    // Moves played so far, game and search alike, newest last
+    UndoEntry undoStack[MAX_UNDO];
+    int undoCount;
+
+    // Shared search results; owned by the caller and may be null
+    TranspositionTable* tt;
+
+    // Endgame tables, likewise
+    const Tablebases* tablebases;
+
+    // Pawn structure cache, likewise but never shared between threads;
+    // without it the pawns are scored afresh at every evaluation
+    PawnTable* pawnTable;
+
+    // Chance for the weak levels' pick among near-best root moves,
+    // likewise; without it the search always plays the move it scores best
+    RandomGenerator* random;
+
+    // Clock of the running search. Once stopped is set every node returns
+    // at once and the unfinished iteration is thrown away.
+    std::chrono::steady_clock::time_point searchStart;
+    std::chrono::steady_clock::time_point searchDeadline;
+    bool hasDeadline;
+    bool stopped;
+    const std::atomic<bool>* stopSignal;
+    const std::atomic<bool>* ponderSignal;
+    int rootDepth;
+    uint64_t nodes;
+    uint64_t nodeLimit;
+
+    // Deepest ply reached in the current iteration, the optional counters,
+    // and where progress goes for other threads to see
+    int selDepth;
+    SearchStats stats;
+    std::atomic<uint64_t>* nodeCounter;
+    std::function<void(const SearchInfo&)> infoListener;
+
+    SearchOptions options;
+
+    // Quiet-move ordering learned during a search: two killer moves per
+    // ply, the reply that refuted each previous move, and a history score
+    // per side and from/to squares that rises with every cutoff
+    Move killers[MAX_PLY][2];
+    Move counterMoves[64][64];
+    int history[3][64][64];
+
+    void clearMoveOrdering();
+
+    // Rewards a quiet move that caused a cutoff and penalises the quiet
+    // moves searched before it
+    void updateQuietStats(const Move& move, int ply, int depth, const Move* tried, int triedCount);
+
+    // Passes the turn without moving, for null-move pruning
+    void makeNullMove();
+    void unmakeNullMove();
+
+    // Whether the side to move has anything besides king and pawns, the
+    // positions where passing is rarely the best option
+    bool hasNonPawnMaterial() const;
+
+    // Whether the position has come up before with the same side to move
+    // since the last capture or pawn move, or fifty moves have gone by
+    // without one. A null move ends the look back, as what came before it
+    // cannot be reached again.
+    bool isDrawByRule() const;
+
+    // Whether the pseudo-legal move would check the opponent, worked out
+    // from the attack tables without making it
+    bool givesCheck(const Move& move) const;
+
+    void checkTime();
+    int elapsedMs() const;
+
+    bool pondering() const {
+        return ponderSignal && ponderSignal->load(std::memory_order_relaxed);
+    }
+
+    // The tables' score for the position at ply, a mate score counted from
+    // the root or a draw; false when they do not cover it
+    bool probeTablebases(int ply, int& score);
+
+    // The best root move by the tables, when they cover every reply
+    bool tablebaseRootMove(MoveList& rootMoves, Move& bestMove);
+
+    // The main line after an iteration: its best move, then the table's
+    // choice in each position it leads to, for as long as that is legal
+    void principalVariation(const Move& bestMove, int depth, SearchInfo& info);
+
+    // One iteration over the root moves; check stopped before trusting it
+    int searchRoot(MoveList& rootMoves, int depth, int alpha, int beta, int margin, Move& bestMove);
+
+    // Draws the move to play from an iteration's scored root moves
+    Move pickAmongBest(MoveList scoredMoves, int bestScore, int multiPV, int margin);
+
+    // Piece-square tables
+    static const int pawnTableWhite[8][8];
+    static const int knightTable[8][8];
+    static const int bishopTable[8][8];
+    static const int rookTable[8][8];
+    static const int queenTable[8][8];
+    static const int kingTableMiddle[8][8];
+    static const int kingTableEnd[8][8];
+
+    // Expands the tables above into signed per-color, per-square scores
+    static bool initPieceSquareTables();
+
+    void clearBoard();
+
+    void putPiece(int sq, const Piece& piece);
+
+    void removePiece(int sq);
+
+    void movePiece(int from, int to);
+
+public:
+    ChessGame();
+
+    ~ChessGame();
+
+    // Takes on other's position, the moves that led to it and what it is
+    // searched with: table, tablebases, network and options. Signals,
+    // listeners, the pawn table and move ordering stay this game's own, so
+    // a search thread can start each search from one copy of the board
+    // rather than of the whole game.
+    void copyPosition(const ChessGame& other);
+
+    void initializeBoard();
+
+    // Loads a position in Forsyth-Edwards Notation. On malformed input the
+    // start position is restored and false is returned.
+    bool setFromFen(const std::string& fen);
+
+    bool isInitialized() const {
+        return initialized;
+    }
+
+    uint64_t getHash() const {
+        return hash;
+    }
+
+    void setTranspositionTable(TranspositionTable* table) {
+        tt = table;
+    }
+
+    void setTablebases(const Tablebases* tables) {
+        tablebases = tables;
+    }
+
+    void setPawnTable(PawnTable* table) {
+        pawnTable = table;
+    }
+
+    void setRandom(RandomGenerator* generator) {
+        random = generator;
+    }
+
+    void setSearchOptions(const SearchOptions& searchOptions) {
+        options = searchOptions;
+    }
+
+    const SearchOptions& getSearchOptions() const {
+        return options;
+    }
+
+    // Switches evaluation to the network, or back to the piece-square
+    // tables when it is null or not loaded
+    void setNetwork(const NnueNetwork* net);
+
+    bool usesNetwork() const {
+        return network != nullptr;
+    }
+
+    // Another thread can end a running search early by setting this flag
+    void setStopSignal(const std::atomic<bool>* signal) {
+        stopSignal = signal;
+    }
+
+    // While this flag is set the search is pondering and ignores its time
+    // limit; once cleared, the time spent so far counts against it
+    void setPonderSignal(const std::atomic<bool>* signal) {
+        ponderSignal = signal;
+    }
+
+    // Adds 1024 to counter per 1024 nodes searched, so another thread can
+    // follow the search's progress
+    void setNodeCounter(std::atomic<uint64_t>* counter) {
+        nodeCounter = counter;
+    }
+
+    // Called on the searching thread after each iteration the main search
+    // completes
+    void setInfoListener(std::function<void(const SearchInfo&)> listener) {
+        infoListener = std::move(listener);
+    }
+
+    // Of the last getBestMove call, exact once it has returned
+    uint64_t getNodes() const {
+        return nodes;
+    }
+
+    const SearchStats& getStats() const {
+        return stats;
+    }
+
+    // The table's best move for the side to move, if it is legal here: the
+    // reply the last search expected
+    Move expectedReply();
+
+    // Hashes the position from scratch; the incremental key must always match
+    uint64_t computeHash() const;
+
+    // Recomputes from the board what makeMove and unmakeMove keep up to date
+    // besides the hash: the pawn key, the material, piece-square scores and
+    // phase, and with a network the accumulator, by its plain kernels, and
+    // the evaluation. Names the first that differs, empty when all match.
+    std::string verifyIncremental() const;
+
+    int getPiece(int row, int col);
+
+    // getPiece's code for every square, row by row from a8
+    void getBoard(int codes[64]) const;
+
+    bool isValidPosition(int row, int col) {
+        return row >= 0 && row < 8 && col >= 0 && col < 8;
+    }
+
+    std::vector<Move> getLegalMoves(int row, int col);
+
+    // Pieces of either color attacking sq, given the occupancy occ
+    Bitboard attackersTo(int sq, Bitboard occ);
+
+    // Pieces of the given color that shield their own king from a slider
+    Bitboard pinnedPieces(Color color);
+
+    // Checkers and pinned pieces of the side to move
+    CheckInfo getCheckInfo();
+
+    void generateLegalMoves(MoveList& moves, GenType type = GEN_ALL);
+
+    // Generates exactly the legal moves of the requested kind. With checkers
+    // and pinned pieces known, no move has to be played to test it; only en
+    // passant, which can expose the king along the rank, is still verified
+    // by making it.
+    void generateLegalMoves(MoveList& moves, GenType type, const CheckInfo& info);
+
+    Bitboard pieceAttacks(PieceType type, int sq);
+
+    // Adds one move from sq to every square in targets
+    void addMoves(int sq, Bitboard targets, MoveList& moves);
+
+    // Queen promotions count as captures, underpromotions as quiet moves
+    void addPromotions(int from, int to, int flags, GenType type, MoveList& moves);
+
+    void generatePawnMoves(GenType type, Bitboard checkMask, Bitboard pinned, MoveList& moves);
+
+    bool isEmpty(int row, int col);
+
+    // Castling; a right is only held while king and rook are unmoved
+    void generateCastling(MoveList& moves);
+
+    bool isSquareAttacked(int row, int col, Color attackerColor);
+
+    bool isInCheck(Color color);
+
+    // Square of the pawn removed by an en passant capture landing on 'to'
+    int enPassantVictim(int to, Color mover) const;
+
+    bool isLegalMove(const Move& move);
+
+    // Whether a move from elsewhere (hash move, killer) could be generated
+    // in this position, ignoring whether it leaves the king in check
+    bool isPseudoLegal(const Move& move);
+
+    bool makeMove(int fromRow, int fromCol, int toRow, int toCol, int promotionPiece = QUEEN);
+
+    // Plays a pseudo-legal move, recording what unmakeMove needs to undo it
+    void makeMove(const Move& move);
+
+    void unmakeMove();
+
+    void executeMoveInternal(const Move& move);
+
+    // Static evaluation from White's point of view: material, piece-square
+    // tables and pawn structure
+    int evaluateBoard();
+
+    // Static evaluation from the side to move's point of view, by the
+    // network when one is set
+    int evaluate();
+
+    int scoreMoveOrdering(const Move& move);
+
+    int historyScore(const Move& move) const {
+        return history[currentPlayer][move.from()][move.to()];
+    }
+
+    // Static exchange evaluation: the material the side to move wins or
+    // loses on the target square if both sides keep recapturing with their
+    // least valuable piece, and either may stop when that is better
+    int staticExchange(const Move& move);
+
+    int search(int depth, int ply, int alpha, int beta);
+
+    // Captures only, past the nominal depth, until the position is quiet
+    int quiescence(int ply, int alpha, int beta);
+
+    // Iterative deepening until limits run out; returns the best move of
+    // the deepest completed iteration. Threads other than 0 are Lazy SMP
+    // helpers that search the same position to fill the shared table.
+    Move getBestMove(const SearchLimits& limits, int threadIndex = 0);
+
+    int getCurrentPlayer();
+
+    bool isGameOver();
+};
+
+#endif // CHECKMATE_ENGINE_CHESS_GAME_H
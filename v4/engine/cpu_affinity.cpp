@@ -0,0 +1,71 @@
+#include "cpu_affinity.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "log.h"
+
+namespace {
+
+// Highest frequency in kHz the core can run at, or 0 if unknown
+long maxFrequency(int core) {
+    char path[96];
+    std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", core);
+    FILE* file = std::fopen(path, "r");
+    if (!file) return 0;
+
+    long frequency = 0;
+    if (std::fscanf(file, "%ld", &frequency) != 1) frequency = 0;
+    std::fclose(file);
+    return frequency;
+}
+
+std::vector<int> detectFastCores() {
+    int coreCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<long> frequencies(coreCount);
+    long fastest = 0;
+    for (int core = 0; core < coreCount; core++) {
+        frequencies[core] = maxFrequency(core);
+        fastest = std::max(fastest, frequencies[core]);
+    }
+
+    std::vector<int> cores;
+    for (int core = 0; core < coreCount; core++) {
+        if (fastest == 0 || frequencies[core] * 4 >= fastest * 3) cores.push_back(core);
+    }
+    LOGD("%zu of %d cores selected for search", cores.size(), coreCount);
+    return cores;
+}
+
+} // namespace
+
+const std::vector<int>& fastCores() {
+    static const std::vector<int> cores = detectFastCores();
+    return cores;
+}
+
+bool pinThreadToCores(const std::vector<int>& cores) {
+#if defined(__linux__)
+    if (cores.empty()) return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int core : cores) {
+        if (core >= 0 && core < CPU_SETSIZE) CPU_SET(core, &set);
+    }
+    // pid 0 is the calling thread
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cores;
+    return false;
+#endif
+}
+
+int recommendedThreadCount() {
+    return std::max(1, static_cast<int>(fastCores().size()));
+}
@@ -0,0 +1,19 @@
+// Core selection for search threads on big.LITTLE devices
+#ifndef CHECKMATE_ENGINE_CPU_AFFINITY_H
+#define CHECKMATE_ENGINE_CPU_AFFINITY_H
+
+#include <vector>
+
+// Cores whose top clock is within a quarter of the fastest one: the big
+// and prime cores of a big.LITTLE SoC, or every core of a uniform CPU.
+// Read once from cpufreq; all cores when that is unavailable.
+const std::vector<int>& fastCores();
+
+// Keeps the calling thread on the given cores. False where thread
+// affinity is unsupported or the cores are rejected.
+bool pinThreadToCores(const std::vector<int>& cores);
+
+// Search threads worth running by default: one per fast core
+int recommendedThreadCount();
+
+#endif // CHECKMATE_ENGINE_CPU_AFFINITY_H
@@ -0,0 +1,274 @@
+#include "engine.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "cpu_affinity.h"
+#include "log.h"
+
+Engine::Engine()
+    : stopFlag(false), helperStopFlag(false), ponderFlag(false), searching(false),
+      threadCount(std::min(recommendedThreadCount(), MAX_SEARCH_THREADS)), book(nullptr),
+      result(Move::none()), hasResult(false), searchedNodes(0), hasInfo(false), searchId(0),
+      activeThreads(0), helpersRunning(0), busy(false), quitting(false) {}
+
+Engine::~Engine() {
+    releaseThreads();
+}
+
+void Engine::setThreadCount(int threads) {
+    threadCount.store(std::max(1, std::min(threads, MAX_SEARCH_THREADS)));
+    LOGD("Search threads set to %d", threadCount.load());
+}
+
+int Engine::getThreadCount() const {
+    return threadCount.load();
+}
+
+void Engine::setBook(const OpeningBook* openingBook) {
+    book = openingBook;
+}
+
+void Engine::startSearch(const ChessGame& position, const SearchLimits& limits) {
+    int threads = limits.maxNodes ? 1 : threadCount.load();
+    ChessGame& game = prepareSearch(position, threads);
+
+    // A book move is the result as it stands, with no thread to wake
+    if (book) {
+        Move move = book->probe(game, random);
+        if (!move.isNull()) {
+            LOGD("Book move %s", moveToString(move).c_str());
+            std::lock_guard<std::mutex> lock(resultMutex);
+            result = move;
+            hasResult = true;
+            return;
+        }
+    }
+
+    beginSearch(limits, threads, false);
+}
+
+ChessGame& Engine::prepareSearch(const ChessGame& position, int count) {
+    cancelSearch();
+    {
+        std::lock_guard<std::mutex> lock(infoMutex);
+        hasInfo = false;
+    }
+
+    while (static_cast<int>(searchThreads.size()) < count) {
+        int index = static_cast<int>(searchThreads.size());
+        std::unique_ptr<SearchThread> created(new SearchThread());
+        ChessGame& game = created->game;
+        // Helpers run until the main search is done with them
+        game.setStopSignal(index == 0 ? &stopFlag : &helperStopFlag);
+        game.setNodeCounter(&searchedNodes);
+        game.setPawnTable(&created->pawnTable);
+        // Helpers ponder as long as the main search, so after a ponder hit
+        // every thread is still filling the table
+        game.setPonderSignal(&ponderFlag);
+        if (index == 0) {
+            game.setRandom(&random);
+            game.setInfoListener([this](const SearchInfo& iteration) {
+                std::lock_guard<std::mutex> lock(infoMutex);
+                info = iteration;
+                info.nodes = std::max(iteration.nodes, searchedNodes.load(std::memory_order_relaxed));
+                hasInfo = true;
+            });
+        }
+
+        SearchThread* searchThread = created.get();
+        searchThreads.push_back(std::move(created));
+        searchThread->thread = std::thread(&Engine::threadLoop, this, index, searchThread);
+    }
+
+    ChessGame& game = searchThreads[0]->game;
+    game.copyPosition(position);
+    return game;
+}
+
+void Engine::beginSearch(const SearchLimits& limits, int threads, bool ponder) {
+    const ChessGame& position = searchThreads[0]->game;
+    for (int i = 1; i < threads; i++) {
+        searchThreads[i]->game.copyPosition(position);
+    }
+
+    searchedNodes.store(0);
+    ponderFlag.store(ponder);
+    stopFlag.store(false);
+    helperStopFlag.store(false);
+    searching.store(true);
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        searchLimits = limits;
+        searchStart = std::chrono::steady_clock::now();
+        activeThreads = threads;
+        helpersRunning = threads - 1;
+        busy = true;
+        searchId++;
+    }
+    workReady.notify_all();
+}
+
+// Waits for each search it takes part in; a thread created during a search
+// has seen none, so it joins that one too
+void Engine::threadLoop(int index, SearchThread* self) {
+    pinThreadToCores(fastCores());
+
+    uint64_t lastSearch = 0;
+    while (true) {
+        SearchLimits limits;
+        {
+            std::unique_lock<std::mutex> lock(workMutex);
+            workReady.wait(lock, [&]() { return quitting || (searchId != lastSearch && index < activeThreads); });
+            if (quitting) return;
+            lastSearch = searchId;
+            limits = searchLimits;
+        }
+
+        if (index == 0) {
+            runMainSearch(*self, limits);
+            continue;
+        }
+
+        self->game.getBestMove(limits, index);
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            helpersRunning--;
+        }
+        workDone.notify_all();
+    }
+}
+
+void Engine::runMainSearch(SearchThread& self, const SearchLimits& limits) {
+    Move move = self.game.getBestMove(limits);
+
+    std::chrono::steady_clock::time_point start;
+    int threads;
+    {
+        helperStopFlag.store(true);
+        std::unique_lock<std::mutex> lock(workMutex);
+        workDone.wait(lock, [this]() { return helpersRunning == 0; });
+        start = searchStart;
+        threads = activeThreads;
+    }
+
+    // Exact totals now that every thread has finished
+    {
+        std::lock_guard<std::mutex> lock(infoMutex);
+        info.timeMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        info.nodes = 0;
+        info.stats = SearchStats();
+        for (int i = 0; i < threads; i++) {
+            info.nodes += searchThreads[i]->game.getNodes();
+            info.stats.add(searchThreads[i]->game.getStats());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        result = move;
+        hasResult = true;
+    }
+    searching.store(false);
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        busy = false;
+    }
+    workDone.notify_all();
+}
+
+Move Engine::startPondering(const ChessGame& position, const SearchLimits& limits) {
+    int threads = limits.maxNodes ? 1 : threadCount.load();
+    ChessGame& ponderPosition = prepareSearch(position, threads);
+
+    Move guess = ponderPosition.expectedReply();
+    if (guess.isNull()) return Move::none();
+
+    int promotion = guess.isPromotion() ? guess.promotionType() : QUEEN;
+    if (!ponderPosition.makeMove(rowOf(guess.from()), colOf(guess.from()), rowOf(guess.to()),
+                                 colOf(guess.to()), promotion) ||
+        ponderPosition.isGameOver()) {
+        return Move::none();
+    }
+    // The reply to it would come from the book anyway
+    if (book && !book->probe(ponderPosition, random).isNull()) return Move::none();
+
+    beginSearch(limits, threads, true);
+    LOGD("Pondering on %s", moveToString(guess).c_str());
+    return guess;
+}
+
+void Engine::ponderHit() {
+    ponderFlag.store(false);
+}
+
+bool Engine::isPondering() const {
+    return ponderFlag.load() && searching.load();
+}
+
+void Engine::stopSearch() {
+    stopFlag.store(true);
+}
+
+void Engine::cancelSearch() {
+    stopFlag.store(true);
+    waitForIdle();
+    ponderFlag.store(false);
+
+    std::lock_guard<std::mutex> lock(resultMutex);
+    result = Move::none();
+    hasResult = false;
+}
+
+bool Engine::isSearching() const {
+    return searching.load();
+}
+
+void Engine::releaseThreads() {
+    cancelSearch();
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        quitting = true;
+    }
+    workReady.notify_all();
+    for (std::unique_ptr<SearchThread>& searchThread : searchThreads) {
+        searchThread->thread.join();
+    }
+    searchThreads.clear();
+
+    // Threads created later wait for a search of their own rather than
+    // taking the last one for theirs
+    std::lock_guard<std::mutex> lock(workMutex);
+    quitting = false;
+    activeThreads = 0;
+}
+
+bool Engine::pollResult(Move& move) {
+    std::lock_guard<std::mutex> lock(resultMutex);
+    if (!hasResult) return false;
+
+    move = result;
+    hasResult = false;
+    return true;
+}
+
+Move Engine::waitForResult() {
+    waitForIdle();
+
+    Move move = Move::none();
+    pollResult(move);
+    return move;
+}
+
+bool Engine::getSearchInfo(SearchInfo& searchInfo) {
+    std::lock_guard<std::mutex> lock(infoMutex);
+    if (!hasInfo) return false;
+    searchInfo = info;
+    return true;
+}
+
+void Engine::waitForIdle() {
+    std::unique_lock<std::mutex> lock(workMutex);
+    workDone.wait(lock, [this]() { return !busy; });
+}
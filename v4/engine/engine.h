@@ -0,0 +1,147 @@
+// Background search: runs getBestMove on worker threads so the caller
+// never blocks on it
+#ifndef CHECKMATE_ENGINE_ENGINE_H
+#define CHECKMATE_ENGINE_ENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "book.h"
+#include "chess_game.h"
+#include "pawns.h"
+#include "random.h"
+#include "search_info.h"
+#include "types.h"
+
+// Upper bound for setThreadCount
+const int MAX_SEARCH_THREADS = 16;
+
+class Engine {
+public:
+    Engine();
+    ~Engine();
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    // Threads per search: one main search plus Lazy SMP helpers that share
+    // its transposition table. Defaults to the number of fast cores; takes
+    // effect from the next startSearch. A search with a node budget always
+    // runs alone, as helpers would only make the level stronger.
+    void setThreadCount(int threads);
+    int getThreadCount() const;
+
+    // Positions found in the book are answered from it at once, without a
+    // search. The book must outlive the engine or be replaced first; null
+    // turns it off.
+    void setBook(const OpeningBook* openingBook);
+
+    // Starts searching a copy of position, so the caller may keep using
+    // its own board. A search already running is cancelled first.
+    void startSearch(const ChessGame& position, const SearchLimits& limits);
+
+    // Pondering: guesses the opponent's reply from the table and searches
+    // the position after it while the opponent thinks, clock stopped.
+    // Returns the guess, or the null move when there is nothing to ponder.
+    Move startPondering(const ChessGame& position, const SearchLimits& limits);
+
+    // The opponent played the guessed move: the ponder search becomes the
+    // real one, and the time already spent counts against its limit
+    void ponderHit();
+
+    bool isPondering() const;
+
+    // Ends the running search early; its best move so far is the result
+    void stopSearch();
+
+    // Ends the running search and discards its result
+    void cancelSearch();
+
+    bool isSearching() const;
+
+    // Cancels any search and ends the search threads, giving back their
+    // games and pawn caches; the next search creates them again
+    void releaseThreads();
+
+    // Hands over the finished search's move once; false while searching
+    // or when there is nothing to collect
+    bool pollResult(Move& move);
+
+    // Blocks until the running search finishes, then hands over its move
+    Move waitForResult();
+
+    // The latest iteration of the running or last search, refreshed as each
+    // one completes; false before the first, and for a book move
+    bool getSearchInfo(SearchInfo& searchInfo);
+
+private:
+    // A thread that lives as long as the engine, with the game it searches,
+    // reset for each search from the position alone, and a pawn cache that
+    // stays warm from move to move: the main search is the first, then one
+    // per helper
+    struct SearchThread {
+        ChessGame game;
+        PawnTable pawnTable;
+        std::thread thread;
+    };
+
+    std::atomic<bool> stopFlag;
+    std::atomic<bool> helperStopFlag;
+    std::atomic<bool> ponderFlag;
+    std::atomic<bool> searching;
+    std::atomic<int> threadCount;
+    const OpeningBook* book;
+
+    // Used by one search at a time: the weak levels' choice of move, and
+    // the book choice before it starts
+    RandomGenerator random;
+
+    // Guards result and hasResult
+    std::mutex resultMutex;
+    Move result;
+    bool hasResult;
+
+    // Nodes of all threads, added to as they search
+    std::atomic<uint64_t> searchedNodes;
+
+    // Guards info and hasInfo
+    std::mutex infoMutex;
+    SearchInfo info;
+    bool hasInfo;
+
+    // Created as searches first need them and kept until releaseThreads;
+    // resized only while no search runs
+    std::vector<std::unique_ptr<SearchThread>> searchThreads;
+
+    // Guards what follows, the hand-over between the caller and the
+    // threads. Each search bumps searchId; the threads below activeThreads
+    // take part, the helpers counting themselves out in helpersRunning.
+    std::mutex workMutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    uint64_t searchId;
+    int activeThreads;
+    int helpersRunning;
+    bool busy;
+    bool quitting;
+    SearchLimits searchLimits;
+    std::chrono::steady_clock::time_point searchStart;
+
+    // Cancels any search, creates the threads up to count and copies
+    // position into the main search's game, which it returns
+    ChessGame& prepareSearch(const ChessGame& position, int count);
+
+    // Copies the main game's position to the helpers and wakes the threads
+    void beginSearch(const SearchLimits& limits, int threads, bool ponder);
+
+    void threadLoop(int index, SearchThread* self);
+    void runMainSearch(SearchThread& self, const SearchLimits& limits);
+    void waitForIdle();
+};
+
+#endif // CHECKMATE_ENGINE_ENGINE_H
@@ -0,0 +1,241 @@
+#include "game_pool.h"
+
+#include "log.h"
+
+namespace {
+
+const int DEFAULT_DIFFICULTY = 2;
+
+uint64_t makeHandle(uint32_t index, uint32_t generation) {
+    return (static_cast<uint64_t>(generation) << 32) | (index + 1);
+}
+
+} // namespace
+
+SharedResources::SharedResources() : resources(std::make_shared<GameResources>()) {}
+
+void SharedResources::publish(std::shared_ptr<const GameResources> latest) {
+    std::lock_guard<std::mutex> lock(mutex);
+    resources = std::move(latest);
+}
+
+std::shared_ptr<const GameResources> SharedResources::current() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return resources;
+}
+
+GameInstance::GameInstance(int hashMB, int threads, const SharedResources* resources)
+    : table(hashMB), sharedResources(resources), difficulty(DEFAULT_DIFFICULTY), version(0),
+      legalMovesInCheck(false), legalMovesVersion(~0u), ponderMove(Move::none()), ponderHitPending(false) {
+    game.setTranspositionTable(&table);
+    if (threads > 0) engine.setThreadCount(threads);
+}
+
+void GameInstance::newGame() {
+    cancelSearch();
+    game.initializeBoard();
+    version++;
+}
+
+void GameInstance::refreshResources() {
+    if (!sharedResources) return;
+    std::shared_ptr<const GameResources> latest = sharedResources->current();
+    if (latest == resources) return;
+
+    // The game and engine hold plain pointers; the reference kept here is
+    // what keeps them valid
+    resources = std::move(latest);
+    game.setNetwork(resources->network.get());
+    game.setTablebases(resources->tablebases.get());
+    engine.setBook(resources->book.get());
+}
+
+bool GameInstance::makeMove(int fromRow, int fromCol, int toRow, int toCol) {
+    if (!game.makeMove(fromRow, fromCol, toRow, toCol)) return false;
+    version++;
+
+    // A ponder search is on the right position only if the guess was
+    // played; otherwise drop it and keep what it put in the table
+    if (!ponderMove.isNull()) {
+        bool guessed = ponderMove.from() == squareOf(fromRow, fromCol) &&
+                       ponderMove.to() == squareOf(toRow, toCol) &&
+                       (!ponderMove.isPromotion() || ponderMove.promotionType() == QUEEN);
+        if (guessed) {
+            engine.ponderHit();
+            ponderMove = Move::none();
+            ponderHitPending = true;
+        } else {
+            cancelSearch();
+        }
+    }
+    return true;
+}
+
+void GameInstance::startSearch() {
+    // After a ponder hit the search for this position is already running
+    if (ponderHitPending) {
+        ponderHitPending = false;
+        return;
+    }
+
+    cancelSearch();
+    refreshResources();
+    engine.startSearch(game, SearchLimits::forDifficulty(difficulty));
+}
+
+Move GameInstance::searchMove() {
+    startSearch();
+    return engine.waitForResult();
+}
+
+bool GameInstance::pollMove(Move& move) {
+    // Read the flag first: the worker stores its move before clearing it
+    bool running = engine.isSearching();
+    if (engine.pollResult(move)) return true;
+    if (running) return false;
+    move = Move::none();
+    return true;
+}
+
+bool GameInstance::startPondering() {
+    cancelSearch();
+    refreshResources();
+    ponderMove = engine.startPondering(game, SearchLimits::forDifficulty(difficulty));
+    return !ponderMove.isNull();
+}
+
+void GameInstance::stopPondering() {
+    if (!ponderMove.isNull()) {
+        cancelSearch();
+    }
+}
+
+void GameInstance::cancelSearch() {
+    engine.cancelSearch();
+    ponderMove = Move::none();
+    ponderHitPending = false;
+}
+
+const MoveList& GameInstance::legalMoves() {
+    if (legalMovesVersion != version) {
+        legalMoveCache = MoveList();
+        game.generateLegalMoves(legalMoveCache);
+        legalMovesInCheck = game.isInCheck(static_cast<Color>(game.getCurrentPlayer()));
+        legalMovesVersion = version;
+    }
+    return legalMoveCache;
+}
+
+GameStatus GameInstance::getStatus() {
+    if (!legalMoves().empty()) return GAME_ONGOING;
+    return legalMovesInCheck ? GAME_CHECKMATE : GAME_STALEMATE;
+}
+
+GamePool::GamePool(int hashMB, int threads, const SharedResources* resources)
+    : hashMB(hashMB), threads(threads), resources(resources), slotCount(0) {
+    for (std::atomic<Slot*>& chunk : chunks) chunk.store(nullptr);
+}
+
+GamePool::~GamePool() {
+    for (std::atomic<Slot*>& chunk : chunks) {
+        delete[] chunk.load();
+    }
+}
+
+uint64_t GamePool::create() {
+    std::lock_guard<std::mutex> guard(poolMutex);
+
+    uint32_t index;
+    if (!freeSlots.empty()) {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        if (slotCount == static_cast<uint32_t>(CHUNK_SIZE * MAX_CHUNKS)) {
+            LOGE("Game pool is full at %u games", slotCount);
+            return 0;
+        }
+        index = slotCount;
+        int chunk = static_cast<int>(index / CHUNK_SIZE);
+        if (!chunks[chunk].load()) {
+            Slot* slots = new Slot[CHUNK_SIZE];
+            for (int i = 0; i < CHUNK_SIZE; i++) {
+                slots[i].generation.store(0);
+                slots[i].live.store(false);
+            }
+            chunks[chunk].store(slots, std::memory_order_release);
+        }
+        slotCount++;
+    }
+
+    Slot& slot = slotAt(index);
+    if (!slot.instance) {
+        slot.instance.reset(new GameInstance(hashMB, threads, resources));
+    } else {
+        // A recycled game starts clean, as a new one would
+        std::lock_guard<std::mutex> lock(slot.instance->mutex);
+        slot.instance->newGame();
+        slot.instance->getTable().clear();
+        slot.instance->setDifficulty(DEFAULT_DIFFICULTY);
+    }
+    slot.live.store(true);
+    return makeHandle(index, slot.generation.load());
+}
+
+void GamePool::release(uint64_t handle) {
+    std::unique_lock<std::mutex> lock;
+    GameInstance* instance = this->lock(handle, lock);
+    if (!instance) return;
+
+    // An idle game in the pool keeps its board and table but no thread
+    instance->cancelSearch();
+    instance->getEngine().releaseThreads();
+    uint32_t index = static_cast<uint32_t>(handle & 0xFFFFFFFFu) - 1;
+    Slot& slot = slotAt(index);
+    // Handles still held for the old game no longer match
+    {
+        std::lock_guard<std::mutex> stopLock(slot.stopMutex);
+        slot.generation.fetch_add(1);
+    }
+    lock.unlock();
+
+    std::lock_guard<std::mutex> guard(poolMutex);
+    slot.live.store(false);
+    freeSlots.push_back(index);
+}
+
+GameInstance* GamePool::lock(uint64_t handle, std::unique_lock<std::mutex>& lock) {
+    Slot* slot = find(handle);
+    if (!slot) return nullptr;
+
+    // Checked again under the lock: a release may have got in first
+    lock = std::unique_lock<std::mutex>(slot->instance->mutex);
+    if (slot->generation.load() != static_cast<uint32_t>(handle >> 32)) {
+        lock = std::unique_lock<std::mutex>();
+        return nullptr;
+    }
+    return slot->instance.get();
+}
+
+void GamePool::stopSearch(uint64_t handle) {
+    // The instance is never freed while the pool lives, and stopping only
+    // sets a flag. Checked again under the slot's stop lock, so a release
+    // and create in between cannot hand the signal to the next game.
+    Slot* slot = find(handle);
+    if (!slot) return;
+
+    std::lock_guard<std::mutex> lock(slot->stopMutex);
+    if (slot->generation.load() == static_cast<uint32_t>(handle >> 32)) slot->instance->stopSearch();
+}
+
+GamePool::Slot* GamePool::find(uint64_t handle) {
+    uint32_t low = static_cast<uint32_t>(handle & 0xFFFFFFFFu);
+    uint32_t generation = static_cast<uint32_t>(handle >> 32);
+    if (low == 0 || low > static_cast<uint32_t>(CHUNK_SIZE * MAX_CHUNKS)) return nullptr;
+
+    uint32_t index = low - 1;
+    Slot* chunk = chunks[index / CHUNK_SIZE].load(std::memory_order_acquire);
+    if (!chunk) return nullptr;
+    Slot& slot = chunk[index % CHUNK_SIZE];
+    if (!slot.live.load() || slot.generation.load() != generation) return nullptr;
+    return &slot;
+}
@@ -0,0 +1,199 @@
+// Games hosted side by side: each instance has its own board, search
+// table, move ordering, random source and search thread, and the pool hands
+// them out by opaque handle and recycles them
+#ifndef CHECKMATE_ENGINE_GAME_POOL_H
+#define CHECKMATE_ENGINE_GAME_POOL_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "book.h"
+#include "chess_game.h"
+#include "engine.h"
+#include "nnue.h"
+#include "tablebase.h"
+#include "tt.h"
+#include "types.h"
+
+// How the side to move stands, as getStatus reports it
+enum GameStatus {
+    GAME_ONGOING = 0,
+    GAME_CHECKMATE = 1,
+    GAME_STALEMATE = 2
+};
+
+// The evaluator and read-only data games play with; any may be null
+struct GameResources {
+    std::shared_ptr<const NnueNetwork> network;
+    std::shared_ptr<const OpeningBook> book;
+    std::shared_ptr<const Tablebases> tablebases;
+};
+
+// The set games are to use. Each game takes a reference to it when it
+// starts a search and keeps that until the next, so replacing the set
+// never waits for a game nor frees what a running search reads.
+class SharedResources {
+public:
+    SharedResources();
+
+    // Games see it from their next search on
+    void publish(std::shared_ptr<const GameResources> resources);
+    std::shared_ptr<const GameResources> current() const;
+
+private:
+    // Held only to copy the pointer
+    mutable std::mutex mutex;
+    std::shared_ptr<const GameResources> resources;
+};
+
+// One game and everything that plays the computer's side of it. Callers
+// sharing an instance between threads hold mutex around every call; games
+// share nothing that changes, so one never waits on another.
+class GameInstance {
+public:
+    // resources, if set, must outlive the instance
+    GameInstance(int hashMB, int threads, const SharedResources* resources = nullptr);
+
+    GameInstance(const GameInstance&) = delete;
+    GameInstance& operator=(const GameInstance&) = delete;
+
+    std::mutex mutex;
+
+    // Back to the start position. Any search is cancelled; the table and
+    // the difficulty are kept.
+    void newGame();
+
+    ChessGame& getGame() { return game; }
+    TranspositionTable& getTable() { return table; }
+    Engine& getEngine() { return engine; }
+
+    void setDifficulty(int level) { difficulty = level; }
+    int getDifficulty() const { return difficulty; }
+
+    // Bumped whenever the position changes
+    uint32_t getVersion() const { return version; }
+
+    // Plays a move given by squares, promoting to a queen. If a ponder
+    // search guessed it, that search becomes the computer's reply.
+    bool makeMove(int fromRow, int fromCol, int toRow, int toCol);
+
+    // Searches the computer's move in the background, unless a ponder hit
+    // already has that search running
+    void startSearch();
+
+    // Searches and blocks until the computer's move is found
+    Move searchMove();
+
+    // False while the search runs; otherwise its move, null if none
+    bool pollMove(Move& move);
+
+    // Searches the expected reply while the opponent thinks; false when
+    // there is nothing to ponder on
+    bool startPondering();
+
+    // Ends a ponder search the opponent has not answered yet
+    void stopPondering();
+
+    void stopSearch() { engine.stopSearch(); }
+
+    // Ends any search and forgets what it was pondering on
+    void cancelSearch();
+
+    // Generated once per position
+    const MoveList& legalMoves();
+    GameStatus getStatus();
+
+private:
+    ChessGame game;
+    TranspositionTable table;
+    Engine engine;
+
+    // Where new resources come from, and the set in use since the last
+    // search started
+    const SharedResources* sharedResources;
+    std::shared_ptr<const GameResources> resources;
+    int difficulty;
+    uint32_t version;
+
+    MoveList legalMoveCache;
+    bool legalMovesInCheck;
+    uint32_t legalMovesVersion;
+
+    // The reply being pondered on, and whether it was played so the running
+    // search already is the computer's move
+    Move ponderMove;
+    bool ponderHitPending;
+
+    // Takes up the latest shared resources; the search must not be running
+    void refreshResources();
+};
+
+// Instances live in fixed chunks that are never freed, so a handle maps to
+// its instance without locking, and a released instance is reset and
+// handed out again instead of going back to the heap. A handle records its
+// slot and the slot's generation, so one kept after release matches
+// nothing.
+class GamePool {
+public:
+    static const int CHUNK_SIZE = 64;
+    static const int MAX_CHUNKS = 256;
+
+    // Every instance gets a table of hashMB, searches on threads threads and
+    // plays with resources, which must outlive the pool
+    GamePool(int hashMB, int threads, const SharedResources* resources);
+    ~GamePool();
+
+    GamePool(const GamePool&) = delete;
+    GamePool& operator=(const GamePool&) = delete;
+
+    // A game in the start position at the default difficulty; zero when
+    // the pool is full
+    uint64_t create();
+
+    // Stops the game's search, ends its search threads and returns it to
+    // the pool
+    void release(uint64_t handle);
+
+    // The live instance for handle with its mutex locked into lock; null,
+    // and lock left empty, for a handle that is stale or was never issued
+    GameInstance* lock(uint64_t handle, std::unique_lock<std::mutex>& lock);
+
+    // Ends the game's running search early without taking its mutex, so it
+    // also ends a blocking search another thread holds the game for. A
+    // stale handle stops nothing, even racing a release.
+    void stopSearch(uint64_t handle);
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> generation;
+        std::atomic<bool> live;
+        std::unique_ptr<GameInstance> instance;
+
+        // Held while stopSearch checks the generation and stops, and while
+        // release moves the generation on
+        std::mutex stopMutex;
+    };
+
+    int hashMB;
+    int threads;
+    const SharedResources* resources;
+
+    // Guards slot creation and the free list
+    std::mutex poolMutex;
+    std::array<std::atomic<Slot*>, MAX_CHUNKS> chunks;
+    uint32_t slotCount;
+    std::vector<uint32_t> freeSlots;
+
+    Slot& slotAt(uint32_t index) {
+        return chunks[index / CHUNK_SIZE].load(std::memory_order_acquire)[index % CHUNK_SIZE];
+    }
+
+    // The slot handle names if it is live and current, else null
+    Slot* find(uint64_t handle);
+};
+
+#endif // CHECKMATE_ENGINE_GAME_POOL_H
@@ -0,0 +1,18 @@
+// Logging macros: logcat on Android, stderr for host builds
+#ifndef CHECKMATE_ENGINE_LOG_H
+#define CHECKMATE_ENGINE_LOG_H
+
+#if defined(__ANDROID__)
+#include <android/log.h>
+
+#define LOG_TAG "ChessNative"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#include <cstdio>
+
+#define LOGD(...) ((void)0)
+#define LOGE(...) (std::fprintf(stderr, __VA_ARGS__), std::fputc('\n', stderr))
+#endif
+
+#endif // CHECKMATE_ENGINE_LOG_H
@@ -0,0 +1,92 @@
+#include "move_picker.h"
+
+#include <utility>
+
+#include "chess_game.h"
+
+MovePicker::MovePicker(ChessGame& g, Move hashMove, const Move* killerMoves, Move counterMove,
+                       bool onlyCaptures)
+    : game(g), checkInfo(g.getCheckInfo()), ttMove(hashMove), refutationIndex(0),
+      capturesOnly(onlyCaptures && !checkInfo.checkers), stage(STAGE_TT_MOVE), current(0) {
+    refutations[0] = killerMoves ? killerMoves[0] : Move::none();
+    refutations[1] = killerMoves ? killerMoves[1] : Move::none();
+    refutations[2] = counterMove;
+}
+
+bool MovePicker::alreadyTried(const Move& move) const {
+    return move == ttMove || move == refutations[0] || move == refutations[1] || move == refutations[2];
+}
+
+// Selection step: swap the best remaining move to the front and return it
+Move MovePicker::pickBest() {
+    int best = current;
+    for (int i = current + 1; i < moves.count; i++) {
+        if (moves.scores[i] > moves.scores[best]) best = i;
+    }
+    std::swap(moves.moves[best], moves.moves[current]);
+    std::swap(moves.scores[best], moves.scores[current]);
+    return moves.moves[current++];
+}
+
+Move MovePicker::next() {
+    while (true) {
+        switch (stage) {
+            case STAGE_TT_MOVE:
+                stage = STAGE_INIT_CAPTURES;
+                if (game.isPseudoLegal(ttMove) && game.isLegalMove(ttMove)) return ttMove;
+                ttMove = Move::none();
+                break;
+
+            case STAGE_INIT_CAPTURES:
+                moves.count = 0;
+                current = 0;
+                game.generateLegalMoves(moves, GEN_CAPTURES, checkInfo);
+                for (int i = 0; i < moves.count; i++) {
+                    moves.scores[i] = game.scoreMoveOrdering(moves[i]);
+                }
+                stage = STAGE_CAPTURES;
+                break;
+
+            case STAGE_CAPTURES:
+                while (current < moves.count) {
+                    Move move = pickBest();
+                    if (move != ttMove) return move;
+                }
+                stage = capturesOnly ? STAGE_DONE : STAGE_REFUTATIONS;
+                break;
+
+            case STAGE_REFUTATIONS:
+                while (refutationIndex < 3) {
+                    int index = refutationIndex++;
+                    Move move = refutations[index];
+                    if (move == ttMove || move.isCapture() || move.isNull()) continue;
+                    if (index > 0 && move == refutations[0]) continue;
+                    if (index > 1 && move == refutations[1]) continue;
+                    if (game.isPseudoLegal(move) && game.isLegalMove(move)) return move;
+                }
+                stage = STAGE_INIT_QUIETS;
+                break;
+
+            case STAGE_INIT_QUIETS:
+                moves.count = 0;
+                current = 0;
+                game.generateLegalMoves(moves, GEN_QUIETS, checkInfo);
+                for (int i = 0; i < moves.count; i++) {
+                    moves.scores[i] = game.historyScore(moves[i]);
+                }
+                stage = STAGE_QUIETS;
+                break;
+
+            case STAGE_QUIETS:
+                while (current < moves.count) {
+                    Move move = pickBest();
+                    if (!alreadyTried(move)) return move;
+                }
+                stage = STAGE_DONE;
+                break;
+
+            default:
+                return Move::none();
+        }
+    }
+}
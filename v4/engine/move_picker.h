@@ -0,0 +1,51 @@
+// Staged move ordering for the search
+#ifndef CHECKMATE_ENGINE_MOVE_PICKER_H
+#define CHECKMATE_ENGINE_MOVE_PICKER_H
+
+#include "types.h"
+
+class ChessGame;
+
+// Hands out the legal moves of a node one at a time, in stages: the hash
+// move, captures by MVV-LVA, the killer moves and the countermove, then the
+// remaining quiet moves by history score. A stage is only generated and scored once it is reached, so a
+// cutoff on an early move never pays for quiet-move generation at all.
+// With capturesOnly, as in quiescence, the picker stops after the captures
+// unless the side to move is in check and needs every evasion.
+class MovePicker {
+public:
+    MovePicker(ChessGame& game, Move ttMove, const Move* killers, Move counterMove = Move::none(),
+               bool capturesOnly = false);
+
+    bool inCheck() const { return checkInfo.checkers != 0; }
+
+    // Next move to search, or the null move when the node is exhausted
+    Move next();
+
+private:
+    enum Stage {
+        STAGE_TT_MOVE,
+        STAGE_INIT_CAPTURES,
+        STAGE_CAPTURES,
+        STAGE_REFUTATIONS,
+        STAGE_INIT_QUIETS,
+        STAGE_QUIETS,
+        STAGE_DONE
+    };
+
+    ChessGame& game;
+    CheckInfo checkInfo;
+    Move ttMove;
+    // The two killers, then the countermove
+    Move refutations[3];
+    int refutationIndex;
+    bool capturesOnly;
+    int stage;
+    MoveList moves;
+    int current;
+
+    Move pickBest();
+    bool alreadyTried(const Move& move) const;
+};
+
+#endif // CHECKMATE_ENGINE_MOVE_PICKER_H
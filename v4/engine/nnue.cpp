@@ -0,0 +1,276 @@
+#include "nnue.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "log.h"
+
+namespace {
+
+const uint32_t NNUE_VERSION = 1;
+const size_t HEADER_SIZE = 64;
+
+// Clipped ReLU ceiling and the output weights' fixed-point scale
+const int QA = 255;
+const int QB = 64;
+// Converts the network's output unit to centipawns
+const int OUTPUT_SCALE = 400;
+
+const size_t FILE_SIZE = HEADER_SIZE +
+                         sizeof(int16_t) * (NNUE_INPUTS * NNUE_HIDDEN + NNUE_HIDDEN + 2 * NNUE_HIDDEN) +
+                         sizeof(int32_t);
+
+int featureIndex(Color perspective, const Piece& piece, int sq) {
+    int side = (piece.color == perspective) ? 0 : 1;
+    int square = (perspective == WHITE) ? sq : (sq ^ 56);
+    return (side * 6 + (piece.type - PAWN)) * 64 + square;
+}
+
+// Kernels over one perspective's NNUE_HIDDEN values: the accumulator is
+// 64-byte aligned, weights straight from the file need not be. The plain
+// ones are the definition: without SIMD they are used as they are, and the
+// SIMD versions must give exactly what they give.
+void scalarAddWeights(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i++) acc[i] = static_cast<int16_t>(acc[i] + weights[i]);
+}
+
+int32_t scalarClippedDot(const int16_t* acc, const int16_t* weights) {
+    int32_t sum = 0;
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+        int value = acc[i] < 0 ? 0 : (acc[i] > QA ? QA : acc[i]);
+        sum += value * weights[i];
+    }
+    return sum;
+}
+
+#if defined(__AVX2__)
+
+void addWeights(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi16(a, w));
+    }
+}
+
+void subWeights(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_sub_epi16(a, w));
+    }
+}
+
+int32_t clippedDot(const int16_t* acc, const int16_t* weights) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ceiling = _mm256_set1_epi16(QA);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+        a = _mm256_min_epi16(_mm256_max_epi16(a, zero), ceiling);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, w));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+}
+
+#elif defined(__SSE2__)
+
+void addWeights(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(acc + i), _mm_add_epi16(a, w));
+    }
+}
+
+void subWeights(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(acc + i), _mm_sub_epi16(a, w));
+    }
+}
+
+int32_t clippedDot(const int16_t* acc, const int16_t* weights) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ceiling = _mm_set1_epi16(QA);
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+        a = _mm_min_epi16(_mm_max_epi16(a, zero), ceiling);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(a, w));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+#elif defined(__ARM_NEON)
+
+void addWeights(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        vst1q_s16(acc + i, vaddq_s16(vld1q_s16(acc + i), vld1q_s16(weights + i)));
+    }
+}
+
+void subWeights(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        vst1q_s16(acc + i, vsubq_s16(vld1q_s16(acc + i), vld1q_s16(weights + i)));
+    }
+}
+
+int32_t clippedDot(const int16_t* acc, const int16_t* weights) {
+    const int16x8_t zero = vdupq_n_s16(0);
+    const int16x8_t ceiling = vdupq_n_s16(QA);
+    int32x4_t sum = vdupq_n_s32(0);
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        int16x8_t a = vminq_s16(vmaxq_s16(vld1q_s16(acc + i), zero), ceiling);
+        int16x8_t w = vld1q_s16(weights + i);
+        sum = vmlal_s16(sum, vget_low_s16(a), vget_low_s16(w));
+        sum = vmlal_s16(sum, vget_high_s16(a), vget_high_s16(w));
+    }
+#if defined(__aarch64__)
+    return vaddvq_s32(sum);
+#else
+    int32x2_t pair = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+    return vget_lane_s32(vpadd_s32(pair, pair), 0);
+#endif
+}
+
+#else
+
+void addWeights(int16_t* acc, const int16_t* weights) {
+    scalarAddWeights(acc, weights);
+}
+
+void subWeights(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i++) acc[i] = static_cast<int16_t>(acc[i] - weights[i]);
+}
+
+int32_t clippedDot(const int16_t* acc, const int16_t* weights) {
+    return scalarClippedDot(acc, weights);
+}
+
+#endif
+
+} // namespace
+
+NnueNetwork::NnueNetwork()
+    : mapping(nullptr), mappingSize(0), featureWeights(nullptr), featureBias(nullptr),
+      outputWeights(nullptr), outputBias(0) {}
+
+NnueNetwork::~NnueNetwork() {
+    unload();
+}
+
+void NnueNetwork::unload() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    featureWeights = featureBias = outputWeights = nullptr;
+    outputBias = 0;
+}
+
+bool NnueNetwork::load(const std::string& path) {
+    unload();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGE("Cannot open network %s", path.c_str());
+        return false;
+    }
+
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) == FILE_SIZE) {
+        data = mmap(nullptr, FILE_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOGE("Network %s has the wrong size or cannot be mapped", path.c_str());
+        return false;
+    }
+
+    const char* bytes = static_cast<const char*>(data);
+    uint32_t header[3];
+    std::memcpy(header, bytes + 4, sizeof(header));
+    if (std::memcmp(bytes, "CMNN", 4) != 0 || header[0] != NNUE_VERSION ||
+        header[1] != static_cast<uint32_t>(NNUE_INPUTS) || header[2] != static_cast<uint32_t>(NNUE_HIDDEN)) {
+        LOGE("Network %s has an unsupported format", path.c_str());
+        munmap(data, FILE_SIZE);
+        return false;
+    }
+
+    mapping = data;
+    mappingSize = FILE_SIZE;
+    featureWeights = reinterpret_cast<const int16_t*>(bytes + HEADER_SIZE);
+    featureBias = featureWeights + NNUE_INPUTS * NNUE_HIDDEN;
+    outputWeights = featureBias + NNUE_HIDDEN;
+    std::memcpy(&outputBias, outputWeights + 2 * NNUE_HIDDEN, sizeof(outputBias));
+    LOGD("Loaded network %s", path.c_str());
+    return true;
+}
+
+void NnueNetwork::refresh(NnueAccumulator& accumulator, const Piece board[64]) const {
+    for (int side = 0; side < 2; side++) {
+        std::memcpy(accumulator.values[side], featureBias, sizeof(accumulator.values[side]));
+    }
+    for (int sq = 0; sq < 64; sq++) {
+        if (board[sq].type != EMPTY) addPiece(accumulator, board[sq], sq);
+    }
+}
+
+void NnueNetwork::addPiece(NnueAccumulator& accumulator, const Piece& piece, int sq) const {
+    addWeights(accumulator.values[0], featureWeights + featureIndex(WHITE, piece, sq) * NNUE_HIDDEN);
+    addWeights(accumulator.values[1], featureWeights + featureIndex(BLACK, piece, sq) * NNUE_HIDDEN);
+}
+
+void NnueNetwork::removePiece(NnueAccumulator& accumulator, const Piece& piece, int sq) const {
+    subWeights(accumulator.values[0], featureWeights + featureIndex(WHITE, piece, sq) * NNUE_HIDDEN);
+    subWeights(accumulator.values[1], featureWeights + featureIndex(BLACK, piece, sq) * NNUE_HIDDEN);
+}
+
+int NnueNetwork::evaluate(const NnueAccumulator& accumulator, Color sideToMove) const {
+    int us = (sideToMove == WHITE) ? 0 : 1;
+    int64_t output = outputBias;
+    output += clippedDot(accumulator.values[us], outputWeights);
+    output += clippedDot(accumulator.values[1 - us], outputWeights + NNUE_HIDDEN);
+    return static_cast<int>(output * OUTPUT_SCALE / (QA * QB));
+}
+
+void NnueNetwork::refreshScalar(NnueAccumulator& accumulator, const Piece board[64]) const {
+    for (int side = 0; side < 2; side++) {
+        std::memcpy(accumulator.values[side], featureBias, sizeof(accumulator.values[side]));
+    }
+    for (int sq = 0; sq < 64; sq++) {
+        if (board[sq].type == EMPTY) continue;
+        scalarAddWeights(accumulator.values[0], featureWeights + featureIndex(WHITE, board[sq], sq) * NNUE_HIDDEN);
+        scalarAddWeights(accumulator.values[1], featureWeights + featureIndex(BLACK, board[sq], sq) * NNUE_HIDDEN);
+    }
+}
+
+int NnueNetwork::evaluateScalar(const NnueAccumulator& accumulator, Color sideToMove) const {
+    int us = (sideToMove == WHITE) ? 0 : 1;
+    int64_t output = outputBias;
+    output += scalarClippedDot(accumulator.values[us], outputWeights);
+    output += scalarClippedDot(accumulator.values[1 - us], outputWeights + NNUE_HIDDEN);
+    return static_cast<int>(output * OUTPUT_SCALE / (QA * QB));
+}
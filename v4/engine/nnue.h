@@ -0,0 +1,75 @@
+// NNUE evaluation: a small network over piece-square features whose first
+// layer is kept up to date move by move
+#ifndef CHECKMATE_ENGINE_NNUE_H
+#define CHECKMATE_ENGINE_NNUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "types.h"
+
+// Inputs per perspective: own and enemy pieces, six types, 64 squares
+const int NNUE_INPUTS = 2 * 6 * 64;
+const int NNUE_HIDDEN = 256;
+
+// First-layer outputs seen from White's side and from Black's side. The
+// network sums both, the side to move's first.
+struct alignas(64) NnueAccumulator {
+    int16_t values[2][NNUE_HIDDEN];
+};
+
+// A network file mapped read-only into memory. Layout, little-endian:
+//
+//   char     magic[4]    "CMNN"
+//   uint32_t version     1
+//   uint32_t inputs      NNUE_INPUTS
+//   uint32_t hidden      NNUE_HIDDEN
+//   (zero padding to 64 bytes)
+//   int16_t  featureWeights[NNUE_INPUTS][NNUE_HIDDEN]
+//   int16_t  featureBias[NNUE_HIDDEN]
+//   int16_t  outputWeights[2][NNUE_HIDDEN]   side to move, then the other
+//   int32_t  outputBias
+//
+// Features are indexed from each side's point of view: the own pieces
+// first, squares flipped vertically for Black. Hidden values are clipped
+// to [0, 255] before the output layer.
+class NnueNetwork {
+public:
+    NnueNetwork();
+    ~NnueNetwork();
+
+    NnueNetwork(const NnueNetwork&) = delete;
+    NnueNetwork& operator=(const NnueNetwork&) = delete;
+
+    // Maps the file at path, replacing any network loaded before. On a
+    // missing or malformed file nothing is loaded and false is returned.
+    bool load(const std::string& path);
+    bool isLoaded() const { return mapping != nullptr; }
+
+    // Recomputes both perspectives from the board
+    void refresh(NnueAccumulator& accumulator, const Piece board[64]) const;
+
+    void addPiece(NnueAccumulator& accumulator, const Piece& piece, int sq) const;
+    void removePiece(NnueAccumulator& accumulator, const Piece& piece, int sq) const;
+
+    // Centipawns from the side to move's point of view
+    int evaluate(const NnueAccumulator& accumulator, Color sideToMove) const;
+
+    // refresh and evaluate by the plain kernels whatever the build, which
+    // the SIMD ones must match to the bit; for testing them
+    void refreshScalar(NnueAccumulator& accumulator, const Piece board[64]) const;
+    int evaluateScalar(const NnueAccumulator& accumulator, Color sideToMove) const;
+
+private:
+    void* mapping;
+    size_t mappingSize;
+    const int16_t* featureWeights;
+    const int16_t* featureBias;
+    const int16_t* outputWeights;
+    int32_t outputBias;
+
+    void unload();
+};
+
+#endif // CHECKMATE_ENGINE_NNUE_H
@@ -0,0 +1,118 @@
+#include "pawns.h"
+
+#include <algorithm>
+
+namespace {
+
+const Bitboard FILE_A = 0x0101010101010101ULL;
+
+// Penalties per pawn, middlegame and endgame
+const int DOUBLED_MG = 10, DOUBLED_EG = 20;
+const int ISOLATED_MG = 10, ISOLATED_EG = 15;
+const int BACKWARD_MG = 8, BACKWARD_EG = 12;
+
+// Passed pawn bonus by rank counted from the pawn's own side
+const int PASSED_MG[8] = {0, 5, 10, 15, 25, 40, 60, 0};
+const int PASSED_EG[8] = {0, 10, 15, 25, 45, 70, 110, 0};
+
+Bitboard fileBB(int col) {
+    return FILE_A << col;
+}
+
+Bitboard adjacentFiles(int col) {
+    return (col > 0 ? fileBB(col - 1) : 0) | (col < 7 ? fileBB(col + 1) : 0);
+}
+
+// Rows strictly ahead of row for pawns of color, and the rows from row back
+Bitboard rowsAhead(Color color, int row) {
+    if (color == WHITE) return (1ULL << (8 * row)) - 1;
+    return row == 7 ? 0 : ~((1ULL << (8 * (row + 1))) - 1);
+}
+
+Bitboard rowsBehind(Color color, int row) {
+    return ~rowsAhead(color, row);
+}
+
+int relativeRank(Color color, int sq) {
+    return color == WHITE ? 7 - rowOf(sq) : rowOf(sq);
+}
+
+// Structure terms for one side, positive for that side; fills its passers
+void evaluateSide(Color color, Bitboard own, Bitboard enemy, int& mg, int& eg, Bitboard& passed) {
+    passed = 0;
+    Bitboard pawns = own;
+    while (pawns) {
+        int sq = popLsb(pawns);
+        int row = rowOf(sq), col = colOf(sq);
+        Bitboard ahead = rowsAhead(color, row);
+        Bitboard file = fileBB(col);
+        Bitboard adjacent = adjacentFiles(col);
+
+        bool doubled = (own & file & ahead) != 0;
+        bool isolated = (own & adjacent) == 0;
+
+        if (doubled) {
+            mg -= DOUBLED_MG;
+            eg -= DOUBLED_EG;
+        }
+        if (isolated) {
+            mg -= ISOLATED_MG;
+            eg -= ISOLATED_EG;
+        } else if (!(own & adjacent & rowsBehind(color, row))) {
+            // No neighbour can come up to defend it, and it cannot safely
+            // advance to meet them
+            int stop = sq + (color == WHITE ? -8 : 8);
+            if (stop >= 0 && stop < 64 && (pawnAttacks[color][stop] & enemy)) {
+                mg -= BACKWARD_MG;
+                eg -= BACKWARD_EG;
+            }
+        }
+
+        if (!doubled && !(enemy & (file | adjacent) & ahead)) passed |= squareBB(sq);
+    }
+}
+
+} // namespace
+
+// Key zero is the empty structure, which scores nothing: a zeroed entry is
+// correct for it as it stands
+PawnTable::PawnTable() : entries(PAWN_TABLE_SIZE, PawnEntry{0, {0, 0}, 0, 0}) {}
+
+void PawnTable::clear() {
+    std::fill(entries.begin(), entries.end(), PawnEntry{0, {0, 0}, 0, 0});
+}
+
+const PawnEntry& PawnTable::probe(uint64_t key, Bitboard whitePawns, Bitboard blackPawns) {
+    PawnEntry& entry = entries[key & (PAWN_TABLE_SIZE - 1)];
+    if (entry.key != key) evaluatePawns(key, whitePawns, blackPawns, entry);
+    return entry;
+}
+
+void evaluatePawns(uint64_t key, Bitboard whitePawns, Bitboard blackPawns, PawnEntry& entry) {
+    int whiteMg = 0, whiteEg = 0, blackMg = 0, blackEg = 0;
+    evaluateSide(WHITE, whitePawns, blackPawns, whiteMg, whiteEg, entry.passed[0]);
+    evaluateSide(BLACK, blackPawns, whitePawns, blackMg, blackEg, entry.passed[1]);
+    entry.key = key;
+    entry.mg = static_cast<int16_t>(whiteMg - blackMg);
+    entry.eg = static_cast<int16_t>(whiteEg - blackEg);
+}
+
+void scorePassedPawns(const PawnEntry& entry, Bitboard occupied, int& mg, int& eg) {
+    for (int side = 0; side < 2; side++) {
+        Color color = side == 0 ? WHITE : BLACK;
+        int sign = side == 0 ? 1 : -1;
+        Bitboard passed = entry.passed[side];
+        while (passed) {
+            int sq = popLsb(passed);
+            int rank = relativeRank(color, sq);
+            int bonusMg = PASSED_MG[rank], bonusEg = PASSED_EG[rank];
+            int stop = sq + (color == WHITE ? -8 : 8);
+            if (stop >= 0 && stop < 64 && (occupied & squareBB(stop))) {
+                bonusMg /= 2;
+                bonusEg /= 2;
+            }
+            mg += sign * bonusMg;
+            eg += sign * bonusEg;
+        }
+    }
+}
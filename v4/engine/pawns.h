@@ -0,0 +1,46 @@
+// Pawn structure evaluation, cached by a Zobrist key of the pawns alone
+#ifndef CHECKMATE_ENGINE_PAWNS_H
+#define CHECKMATE_ENGINE_PAWNS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.h"
+
+// What the pawns score by themselves, from White's point of view, and
+// which of them are passed. Terms that also depend on other pieces are
+// added at evaluation time from the masks.
+struct PawnEntry {
+    uint64_t key;
+    Bitboard passed[2];   // White's, then Black's
+    int16_t mg;
+    int16_t eg;
+};
+
+const int PAWN_TABLE_SIZE = 8192;
+
+// Scores the pawn structure of key into entry
+void evaluatePawns(uint64_t key, Bitboard whitePawns, Bitboard blackPawns, PawnEntry& entry);
+
+// One per search thread, kept from search to search, so it needs no
+// locking and stays warm across moves. A pawn structure changes in few
+// enough moves that all but a small fraction of evaluations find their
+// entry here.
+class PawnTable {
+public:
+    PawnTable();
+
+    void clear();
+
+    // The entry for this pawn structure, computed on a miss
+    const PawnEntry& probe(uint64_t key, Bitboard whitePawns, Bitboard blackPawns);
+
+private:
+    std::vector<PawnEntry> entries;
+};
+
+// Bonus for the passed pawns in entry, halved for a passer whose next
+// square is occupied, added to mg and eg
+void scorePassedPawns(const PawnEntry& entry, Bitboard occupied, int& mg, int& eg);
+
+#endif // CHECKMATE_ENGINE_PAWNS_H
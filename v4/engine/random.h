@@ -0,0 +1,23 @@
+// Random choices for the weaker levels and the opening book
+#ifndef CHECKMATE_ENGINE_RANDOM_H
+#define CHECKMATE_ENGINE_RANDOM_H
+
+#include <random>
+
+// The weak levels' move choice and book choices for one engine. Not shared between threads;
+// each engine has its own, seeded apart so games started together differ.
+class RandomGenerator {
+private:
+    std::mt19937 rng;
+
+public:
+    RandomGenerator() : rng(std::random_device{}()) {}
+
+    // Uniform in [0, bound)
+    int getBelow(int bound) {
+        std::uniform_int_distribution<int> dist(0, bound - 1);
+        return dist(rng);
+    }
+};
+
+#endif // CHECKMATE_ENGINE_RANDOM_H
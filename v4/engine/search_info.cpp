@@ -0,0 +1,46 @@
+#include "search_info.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef CHECKMATE_SEARCH_STATS
+namespace {
+
+// Tenths of a percent, as "93.4"
+std::string percent(uint64_t part, uint64_t whole) {
+    char text[16];
+    uint64_t permille = whole ? part * 1000 / whole : 0;
+    std::snprintf(text, sizeof(text), "%llu.%llu", static_cast<unsigned long long>(permille / 10),
+                  static_cast<unsigned long long>(permille % 10));
+    return text;
+}
+
+} // namespace
+#endif
+
+std::string SearchInfo::toString() const {
+    std::string line = "depth " + std::to_string(depth) + " seldepth " + std::to_string(selDepth);
+
+    if (std::abs(score) > MATE_BOUND) {
+        // Moves, not plies, negative when the side to move is mated
+        int plies = MATE_SCORE - std::abs(score);
+        int moves = (plies + 1) / 2;
+        line += " score mate " + std::to_string(score > 0 ? moves : -moves);
+    } else {
+        line += " score cp " + std::to_string(score);
+    }
+
+    line += " nodes " + std::to_string(nodes) + " nps " + std::to_string(nodesPerSecond()) +
+            " time " + std::to_string(timeMs) + " hashfull " + std::to_string(hashfull);
+
+#ifdef CHECKMATE_SEARCH_STATS
+    line += " tthit " + percent(stats.ttHits, stats.ttProbes) + " fmc " +
+            percent(stats.firstMoveCutoffs, stats.cutoffs);
+#endif
+
+    if (pvLength > 0) {
+        line += " pv";
+        for (int i = 0; i < pvLength; i++) line += " " + moveToString(pv[i]);
+    }
+    return line;
+}
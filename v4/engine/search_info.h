@@ -0,0 +1,62 @@
+// What a search has done so far: depth, nodes, timing and main line, plus
+// counters for tuning that only builds with CHECKMATE_SEARCH_STATS keep
+#ifndef CHECKMATE_ENGINE_SEARCH_INFO_H
+#define CHECKMATE_ENGINE_SEARCH_INFO_H
+
+#include <cstdint>
+#include <string>
+
+#include "types.h"
+
+// Counted per thread in the search's inner loop, so they cost nothing when
+// compiled out
+#ifdef CHECKMATE_SEARCH_STATS
+#define SEARCH_STAT(counter) (++stats.counter)
+#else
+#define SEARCH_STAT(counter) ((void)0)
+#endif
+
+struct SearchStats {
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    // Fail-highs in the move loop, and those on the first move tried: the
+    // share of the latter is how good the move ordering is
+    uint64_t cutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;
+
+    void add(const SearchStats& other) {
+        ttProbes += other.ttProbes;
+        ttHits += other.ttHits;
+        cutoffs += other.cutoffs;
+        firstMoveCutoffs += other.firstMoveCutoffs;
+    }
+};
+
+// One completed iteration of the main search. Nodes and stats cover every
+// thread once the search is over; while it runs, nodes are counted in
+// steps of 1024 per thread.
+struct SearchInfo {
+    int depth = 0;
+    int selDepth = 0;
+    // From the side to move's point of view
+    int score = 0;
+    int timeMs = 0;
+    uint64_t nodes = 0;
+    // Permille of the table written by this search
+    int hashfull = 0;
+    SearchStats stats;
+
+    // Best move first, then the replies the table expects
+    Move pv[MAX_PLY];
+    int pvLength = 0;
+
+    uint64_t nodesPerSecond() const {
+        return nodes * 1000 / static_cast<uint64_t>(timeMs > 0 ? timeMs : 1);
+    }
+
+    // As a UCI info line without the "info": "depth 9 seldepth 15 score cp
+    // 31 nodes ... pv e2e4 e7e5", with tthit and fmc percentages when counted
+    std::string toString() const;
+};
+
+#endif // CHECKMATE_ENGINE_SEARCH_INFO_H
@@ -0,0 +1,706 @@
+#include "tablebase.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <queue>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bitboard.h"
+#include "log.h"
+
+namespace {
+
+const uint32_t TB_VERSION = 2;
+const size_t HEADER_SIZE = 32;
+const char* const TB_EXTENSION = ".cmtb";
+
+// Small enough that a probe decodes little, large enough that the offsets
+// stay a fraction of a bit per entry
+const uint32_t BLOCK_ENTRIES = 256;
+const int RUN_SYMBOLS = 8;
+const int MAX_CODE_LENGTH = 24;
+
+// Codes up to this long are decoded with one lookup
+const int SHORT_CODE_BITS = 10;
+
+// Name letters, in the order a side's pieces are indexed
+const char PIECE_LETTERS[] = "KQRBNP";
+const PieceType PIECE_ORDER[] = {KING, QUEEN, ROOK, BISHOP, KNIGHT, PAWN};
+
+int pieceRank(PieceType type) {
+    return static_cast<int>(std::find(PIECE_ORDER, PIECE_ORDER + 6, type) - PIECE_ORDER);
+}
+
+// Four bits of count per color and type
+uint64_t materialBit(const Piece& piece) {
+    return 1ULL << (4 * ((piece.color - WHITE) * 7 + piece.type));
+}
+
+struct Placed {
+    int order;
+    int sq;
+};
+
+// The pieces on board in index order; returns how many, or -1 for more than
+// the tables cover
+int collect(const Piece board[64], Placed placed[TB_MAX_PIECES], uint64_t& material) {
+    int count = 0;
+    material = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        const Piece& piece = board[sq];
+        if (piece.type == EMPTY) continue;
+        if (count == TB_MAX_PIECES) return -1;
+        int order = (piece.color - WHITE) * 6 + pieceRank(piece.type);
+        // Insertion sort; squares ascend within a kind as they are visited
+        int i = count++;
+        while (i > 0 && placed[i - 1].order > order) {
+            placed[i] = placed[i - 1];
+            i--;
+        }
+        placed[i] = Placed{order, sq};
+        material += materialBit(piece);
+    }
+    return count;
+}
+
+uint64_t materialOf(const std::vector<Piece>& pieces) {
+    uint64_t material = 0;
+    for (const Piece& piece : pieces) material += materialBit(piece);
+    return material;
+}
+
+int flipFile(int sq) { return sq ^ 7; }
+int flipRank(int sq) { return sq ^ 56; }
+int transpose(int sq) { return ((sq >> 3) | (sq << 3)) & 63; }
+
+// The placements of the two kings that TbIndex numbers, with and without
+// pawns: the white king where the mirroring leaves it and the black king
+// anywhere it is not touching. A white king on the a8-d5 diagonal is
+// mirrored again to put the black king on or above it.
+struct KingPairs {
+    int16_t index[2][64][64];
+    uint8_t squares[2][1806][2];
+    int count[2];
+};
+
+const KingPairs& kingPairs() {
+    static const KingPairs pairs = [] {
+        KingPairs built;
+        for (int pawns = 0; pawns < 2; pawns++) {
+            int count = 0;
+            for (int wk = 0; wk < 64; wk++) {
+                bool placed = colOf(wk) < 4 && (pawns || (rowOf(wk) < 4 && rowOf(wk) <= colOf(wk)));
+                for (int bk = 0; bk < 64; bk++) {
+                    built.index[pawns][wk][bk] = -1;
+                    bool apart = std::abs(rowOf(wk) - rowOf(bk)) > 1 || std::abs(colOf(wk) - colOf(bk)) > 1;
+                    bool above = pawns || rowOf(wk) != colOf(wk) || rowOf(bk) <= colOf(bk);
+                    if (!placed || !apart || !above) continue;
+                    built.index[pawns][wk][bk] = static_cast<int16_t>(count);
+                    built.squares[pawns][count][0] = static_cast<uint8_t>(wk);
+                    built.squares[pawns][count][1] = static_cast<uint8_t>(bk);
+                    count++;
+                }
+            }
+            built.count[pawns] = count;
+        }
+        return built;
+    }();
+    return pairs;
+}
+
+// Binomial coefficients, for numbering sets of squares
+struct Binomials {
+    size_t value[65][TB_MAX_PIECES + 1];
+};
+
+size_t choose(int n, int k) {
+    static const Binomials binomials = [] {
+        Binomials built;
+        for (int m = 0; m <= 64; m++) {
+            for (int j = 0; j <= TB_MAX_PIECES; j++) {
+                built.value[m][j] = j == 0 ? 1 : m == 0 ? 0 : built.value[m - 1][j - 1] + built.value[m - 1][j];
+            }
+        }
+        return built;
+    }();
+    return binomials.value[n][k];
+}
+
+// Code lengths for a Huffman code over the symbol frequencies, none longer
+// than MAX_CODE_LENGTH. Rare symbols are made less rare until they fit.
+std::vector<uint8_t> codeLengths(std::vector<uint64_t> frequencies) {
+    size_t symbols = frequencies.size();
+    std::vector<uint8_t> lengths(symbols, 0);
+    while (true) {
+        typedef std::pair<uint64_t, int> Node;
+        std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+        std::vector<int> parent(symbols, -1);
+        for (size_t s = 0; s < symbols; s++) {
+            if (frequencies[s]) queue.push(Node(frequencies[s], static_cast<int>(s)));
+        }
+        if (queue.size() == 1) {
+            lengths[queue.top().second] = 1;
+            return lengths;
+        }
+        while (queue.size() > 1) {
+            Node a = queue.top();
+            queue.pop();
+            Node b = queue.top();
+            queue.pop();
+            int node = static_cast<int>(parent.size());
+            parent.push_back(-1);
+            parent[a.second] = node;
+            parent[b.second] = node;
+            queue.push(Node(a.first + b.first, node));
+        }
+
+        int longest = 0;
+        for (size_t s = 0; s < symbols; s++) {
+            int length = 0;
+            for (int node = static_cast<int>(s); frequencies[s] && parent[node] >= 0; node = parent[node]) length++;
+            lengths[s] = static_cast<uint8_t>(length);
+            longest = std::max(longest, length);
+        }
+        if (longest <= MAX_CODE_LENGTH) return lengths;
+        for (uint64_t& frequency : frequencies) {
+            if (frequency) frequency = (frequency + 1) / 2;
+        }
+    }
+}
+
+} // namespace
+
+TbIndex::TbIndex(const std::vector<Piece>& pieces) : pieces(pieces), pawns(false), blackKing(0) {
+    for (size_t i = 0; i < pieces.size(); i++) {
+        const Piece& piece = pieces[i];
+        if (piece.type == PAWN) pawns = true;
+        if (piece.type == KING) {
+            if (piece.color == BLACK) blackKing = static_cast<int>(i);
+            continue;
+        }
+        if (!groups.empty()) {
+            Group& last = groups.back();
+            const Piece& previous = pieces[last.first];
+            if (last.first + last.count == static_cast<int>(i) && previous.type == piece.type &&
+                previous.color == piece.color) {
+                last.count++;
+                continue;
+            }
+        }
+        groups.push_back(Group{static_cast<int>(i), 1, piece.type == PAWN, 0});
+    }
+
+    groupEntries = 1;
+    for (Group& group : groups) {
+        group.size = choose(group.pawns ? 48 : 64, group.count);
+        groupEntries *= group.size;
+    }
+    entries = 2 * static_cast<size_t>(kingPairs().count[pawns]) * groupEntries;
+}
+
+size_t TbIndex::groupIndex(const int squares[]) const {
+    size_t index = 0;
+    for (const Group& group : groups) {
+        // At most three squares; insertion sort
+        int sorted[TB_MAX_PIECES];
+        for (int i = 0; i < group.count; i++) {
+            int sq = squares[group.first + i] - (group.pawns ? 8 : 0);
+            int j = i;
+            for (; j > 0 && sorted[j - 1] > sq; j--) sorted[j] = sorted[j - 1];
+            sorted[j] = sq;
+        }
+
+        // The set's rank among all sets of its size
+        size_t set = 0;
+        for (int i = 0; i < group.count; i++) set += choose(sorted[i], i + 1);
+        index = index * group.size + set;
+    }
+    return index;
+}
+
+size_t TbIndex::index(const int squares[], Color sideToMove) const {
+    int count = static_cast<int>(pieces.size());
+    int sq[TB_MAX_PIECES];
+    std::copy(squares, squares + count, sq);
+    auto mirror = [&](int (*map)(int)) {
+        for (int i = 0; i < count; i++) sq[i] = map(sq[i]);
+    };
+
+    if (colOf(sq[0]) > 3) mirror(flipFile);
+    size_t groupPart = 0;
+    bool numbered = false;
+    if (!pawns) {
+        if (rowOf(sq[0]) > 3) mirror(flipRank);
+        int& king = sq[blackKing];
+        if (rowOf(sq[0]) > colOf(sq[0])) {
+            mirror(transpose);
+        } else if (rowOf(sq[0]) == colOf(sq[0])) {
+            if (rowOf(king) > colOf(king)) {
+                mirror(transpose);
+            } else if (rowOf(king) == colOf(king)) {
+                // Both kings on the diagonal: the smaller of the two numbers
+                int transposed[TB_MAX_PIECES];
+                for (int i = 0; i < count; i++) transposed[i] = transpose(sq[i]);
+                groupPart = std::min(groupIndex(sq), groupIndex(transposed));
+                numbered = true;
+            }
+        }
+    }
+    if (!numbered) groupPart = groupIndex(sq);
+
+    const KingPairs& pairs = kingPairs();
+    size_t kings = static_cast<size_t>(pairs.index[pawns][sq[0]][sq[blackKing]]);
+    size_t side = sideToMove == BLACK ? 1 : 0;
+    return (side * pairs.count[pawns] + kings) * groupEntries + groupPart;
+}
+
+void TbIndex::position(size_t index, int squares[], Color& sideToMove) const {
+    const KingPairs& pairs = kingPairs();
+    size_t groupPart = index % groupEntries;
+    size_t kingPart = index / groupEntries;
+    size_t kings = kingPart % pairs.count[pawns];
+    sideToMove = kingPart / pairs.count[pawns] ? BLACK : WHITE;
+    squares[0] = pairs.squares[pawns][kings][0];
+    squares[blackKing] = pairs.squares[pawns][kings][1];
+
+    for (size_t g = groups.size(); g-- > 0;) {
+        const Group& group = groups[g];
+        size_t set = groupPart % group.size;
+        groupPart /= group.size;
+
+        // Largest squares first, each the highest whose count still fits
+        int top = group.pawns ? 48 : 64;
+        for (int i = group.count; i > 0; i--) {
+            int sq = top - 1;
+            while (choose(sq, i) > set) sq--;
+            set -= choose(sq, i);
+            squares[group.first + i - 1] = sq + (group.pawns ? 8 : 0);
+            top = sq;
+        }
+    }
+}
+
+Tablebases::Table::Table(uint64_t material, const std::vector<Piece>& pieces, const std::string& path)
+    : material(material), positions(pieces), path(path), mapping(nullptr), mappingSize(0), unpack(false),
+      blockEntries(0), valueSymbols(0), offsets(nullptr), data(nullptr) {}
+
+bool Tablebases::Table::decode(size_t block, size_t last, uint16_t* out, int& value) const {
+    const uint8_t* bytes = data + offsets[block];
+    size_t size = offsets[block + 1] - offsets[block];
+    size_t bitsLeft = size * 8;
+
+    // The next bits, most significant first; past the block they read as
+    // zero, and codes running into those fail
+    uint64_t buffer = 0;
+    int buffered = 0;
+    size_t nextByte = 0;
+
+    size_t entry = 0;
+    int current = 0;
+    while (true) {
+        while (buffered <= 56) {
+            buffer |= static_cast<uint64_t>(nextByte < size ? bytes[nextByte] : 0) << (56 - buffered);
+            nextByte++;
+            buffered += 8;
+        }
+
+        int symbol = -1;
+        int length = 0;
+        uint32_t shortCode = shortCodes[buffer >> (64 - SHORT_CODE_BITS)];
+        if (shortCode) {
+            symbol = static_cast<int>(shortCode >> 8);
+            length = static_cast<int>(shortCode & 0xFF);
+        } else {
+            // A long code, one bit at a time
+            int code = 0, first = 0, index = 0;
+            for (length = 1; length <= MAX_CODE_LENGTH; length++) {
+                code |= static_cast<int>(buffer >> (64 - length)) & 1;
+                int count = lengthCounts[length];
+                if (code - first < count) {
+                    symbol = sortedSymbols[index + code - first];
+                    break;
+                }
+                index += count;
+                first = (first + count) << 1;
+                code <<= 1;
+            }
+        }
+        if (symbol < 0 || static_cast<size_t>(length) > bitsLeft) return false;
+        buffer <<= length;
+        buffered -= length;
+        bitsLeft -= length;
+
+        size_t run = 1;
+        if (symbol < valueSymbols) {
+            current = symbol;
+        } else if (entry == 0) {
+            return false;
+        } else {
+            run = size_t(1) << (symbol - valueSymbols);
+        }
+        if (out) std::fill(out + entry, out + std::min(entry + run, last + 1), static_cast<uint16_t>(current));
+        entry += run;
+        if (entry > last) {
+            value = current;
+            return true;
+        }
+    }
+}
+
+bool Tablebases::Table::valueAt(size_t index, int& value) const {
+    if (!values.empty()) {
+        value = values[index];
+        return true;
+    }
+    if (!offsets) return false;
+    return decode(index / blockEntries, index % blockEntries, nullptr, value);
+}
+
+Tablebases::Tablebases() : pieceLimit(TB_MAX_PIECES), unpack(false) {}
+
+Tablebases::~Tablebases() {
+    clear();
+}
+
+void Tablebases::clear() {
+    for (const std::unique_ptr<Table>& table : tables) {
+        if (table->mapping) munmap(table->mapping, table->mappingSize);
+    }
+    tables.clear();
+}
+
+void Tablebases::setPath(const std::string& directory) {
+    clear();
+
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        LOGE("Cannot open tablebase directory %s", directory.c_str());
+        return;
+    }
+
+    size_t extensionLength = std::strlen(TB_EXTENSION);
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() <= extensionLength ||
+            name.compare(name.size() - extensionLength, extensionLength, TB_EXTENSION) != 0) {
+            continue;
+        }
+
+        std::vector<Piece> pieces;
+        if (!parseName(name.substr(0, name.size() - extensionLength), pieces)) continue;
+
+        std::unique_ptr<Table> table(new Table(materialOf(pieces), pieces, directory + "/" + name));
+        table->unpack = unpack;
+        tables.push_back(std::move(table));
+    }
+    closedir(dir);
+    LOGD("Found %zu tablebase files in %s", tables.size(), directory.c_str());
+}
+
+void Tablebases::setPieceLimit(int pieces) {
+    pieceLimit = std::max(0, std::min(pieces, TB_MAX_PIECES));
+}
+
+Tablebases::Table* Tablebases::find(uint64_t material) const {
+    for (const std::unique_ptr<Table>& table : tables) {
+        if (table->material == material) return table.get();
+    }
+    return nullptr;
+}
+
+// Runs once per table, on the first probe that needs it. A file that
+// cannot be mapped or does not hold the table its name promises leaves the
+// table empty and its positions unprobed.
+void Tablebases::mapTable(Table& table) {
+    int fd = open(table.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGE("Cannot open tablebase %s", table.path.c_str());
+        return;
+    }
+
+    struct stat info;
+    size_t size = 0;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= HEADER_SIZE) {
+        size = static_cast<size_t>(info.st_size);
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOGE("Tablebase %s is too short or cannot be mapped", table.path.c_str());
+        return;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t version, pieces, blockEntries, blocks;
+    uint64_t entries;
+    uint16_t valueSymbols, runSymbols;
+    std::memcpy(&version, bytes + 4, 4);
+    std::memcpy(&pieces, bytes + 8, 4);
+    std::memcpy(&blockEntries, bytes + 12, 4);
+    std::memcpy(&entries, bytes + 16, 8);
+    std::memcpy(&blocks, bytes + 24, 4);
+    std::memcpy(&valueSymbols, bytes + 28, 2);
+    std::memcpy(&runSymbols, bytes + 30, 2);
+
+    size_t symbols = static_cast<size_t>(valueSymbols) + runSymbols;
+    size_t offsetsStart = (HEADER_SIZE + symbols + 3) & ~size_t(3);
+    size_t dataStart = offsetsStart + 4 * (static_cast<size_t>(blocks) + 1);
+    bool valid = std::memcmp(bytes, "CMTB", 4) == 0 && version == TB_VERSION &&
+                 pieces == table.positions.getPieces().size() && entries == table.positions.size() &&
+                 blockEntries > 0 && (blockEntries & (blockEntries - 1)) == 0 &&
+                 blocks == (entries + blockEntries - 1) / blockEntries && valueSymbols > 0 && runSymbols < 32 &&
+                 dataStart <= size;
+
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(bytes + offsetsStart);
+    for (uint32_t b = 0; valid && b < blocks; b++) valid = offsets[b] <= offsets[b + 1];
+    valid = valid && dataStart + offsets[blocks] == size;
+
+    // The code lengths must make a prefix code
+    std::vector<uint16_t> lengthCounts(MAX_CODE_LENGTH + 1, 0);
+    std::vector<uint16_t> sortedSymbols;
+    for (size_t s = 0; valid && s < symbols; s++) {
+        int length = bytes[HEADER_SIZE + s];
+        valid = length <= MAX_CODE_LENGTH;
+        if (valid && length) lengthCounts[length]++;
+    }
+    int64_t left = 1;
+    for (int length = 1; valid && length <= MAX_CODE_LENGTH; length++) {
+        left = (left << 1) - lengthCounts[length];
+        valid = left >= 0;
+        for (size_t s = 0; s < symbols; s++) {
+            if (bytes[HEADER_SIZE + s] == length) sortedSymbols.push_back(static_cast<uint16_t>(s));
+        }
+    }
+
+    if (!valid) {
+        LOGE("Tablebase %s has an unsupported format", table.path.c_str());
+        munmap(data, size);
+        return;
+    }
+
+    table.blockEntries = blockEntries;
+    table.valueSymbols = valueSymbols;
+    table.offsets = offsets;
+    table.data = bytes + dataStart;
+    // Canonical codes count up within each length, shortest first
+    std::vector<uint32_t> shortCodes(size_t(1) << SHORT_CODE_BITS, 0);
+    uint32_t code = 0;
+    size_t next = 0;
+    for (int length = 1; length <= MAX_CODE_LENGTH; length++, code <<= 1) {
+        for (int i = 0; i < lengthCounts[length]; i++, code++) {
+            uint16_t symbol = sortedSymbols[next++];
+            if (length > SHORT_CODE_BITS) continue;
+            int spare = SHORT_CODE_BITS - length;
+            for (uint32_t fill = 0; fill < (1u << spare); fill++) {
+                shortCodes[(code << spare) | fill] = (static_cast<uint32_t>(symbol) << 8) | length;
+            }
+        }
+    }
+
+    table.lengthCounts = std::move(lengthCounts);
+    table.sortedSymbols = std::move(sortedSymbols);
+    table.shortCodes = std::move(shortCodes);
+
+    if (table.unpack) {
+        std::vector<uint16_t> values(entries);
+        int last = 0;
+        for (size_t b = 0; valid && b < blocks; b++) {
+            size_t count = std::min<size_t>(blockEntries, entries - b * blockEntries);
+            valid = table.decode(b, count - 1, values.data() + b * blockEntries, last);
+        }
+        munmap(data, size);
+        table.offsets = nullptr;
+        table.data = nullptr;
+        if (!valid) {
+            LOGE("Tablebase %s is corrupt", table.path.c_str());
+            return;
+        }
+        table.values = std::move(values);
+        LOGD("Unpacked tablebase %s", table.path.c_str());
+        return;
+    }
+
+    // A search touches scattered blocks; only those pages are read in
+    madvise(data, size, MADV_RANDOM);
+
+    table.mapping = data;
+    table.mappingSize = size;
+    LOGD("Mapped tablebase %s", table.path.c_str());
+}
+
+bool Tablebases::probe(const Piece board[64], Color sideToMove, TbResult& result) const {
+    Placed placed[TB_MAX_PIECES];
+    uint64_t material;
+    int count = collect(board, placed, material);
+    if (count < 0 || count > pieceLimit) return false;
+    if (count == 2) {
+        result = TbResult{0, 0};
+        return true;
+    }
+
+    Table* table = find(material);
+    if (!table) {
+        // Colors reversed: the same position seen from the other side
+        Piece flipped[64];
+        for (int sq = 0; sq < 64; sq++) {
+            const Piece& piece = board[sq ^ 56];
+            flipped[sq] = piece.type == EMPTY ? piece : Piece(piece.type, opposite(piece.color));
+        }
+        collect(flipped, placed, material);
+        table = find(material);
+        if (!table) return false;
+        sideToMove = opposite(sideToMove);
+    }
+
+    std::call_once(table->mapped, mapTable, std::ref(*table));
+    int squares[TB_MAX_PIECES];
+    for (int i = 0; i < count; i++) squares[i] = placed[i].sq;
+    int value;
+    if (!table->valueAt(table->positions.index(squares, sideToMove), value)) return false;
+
+    if (value == 0) {
+        result = TbResult{0, 0};
+    } else {
+        int plies = value - 1;
+        result = TbResult{(plies & 1) ? 1 : -1, plies};
+    }
+    return true;
+}
+
+bool Tablebases::writeTable(const std::string& path, int pieces, const std::vector<uint16_t>& values) {
+    size_t entries = values.size();
+    size_t blocks = (entries + BLOCK_ENTRIES - 1) / BLOCK_ENTRIES;
+    int valueSymbols = 1;
+    for (uint16_t value : values) {
+        if (value != NO_POSITION) valueSymbols = std::max(valueSymbols, value + 1);
+    }
+    if (valueSymbols + RUN_SYMBOLS > 0xFFFF) return false;
+
+    // Each block as symbols: a value, then the run of it that follows in
+    // binary, largest power first. Numbers without a position continue
+    // the run they fall in, or take the block's first value.
+    auto forEachSymbol = [&](size_t block, const std::function<void(int)>& emit) {
+        size_t start = block * BLOCK_ENTRIES;
+        size_t end = std::min(entries, start + BLOCK_ENTRIES);
+        int current = 0;
+        for (size_t i = start; i < end; i++) {
+            if (values[i] != NO_POSITION) {
+                current = values[i];
+                break;
+            }
+        }
+        for (size_t i = start; i < end;) {
+            if (values[i] != NO_POSITION) current = values[i];
+            emit(current);
+            size_t next = i + 1;
+            while (next < end && (values[next] == NO_POSITION || values[next] == current)) next++;
+            size_t run = next - i - 1;
+            for (int k = RUN_SYMBOLS - 1; k >= 0; k--) {
+                if (run & (size_t(1) << k)) emit(valueSymbols + k);
+            }
+            i = next;
+        }
+    };
+
+    std::vector<uint64_t> frequencies(valueSymbols + RUN_SYMBOLS, 0);
+    for (size_t b = 0; b < blocks; b++) {
+        forEachSymbol(b, [&](int symbol) { frequencies[symbol]++; });
+    }
+    std::vector<uint8_t> lengths = codeLengths(frequencies);
+
+    // Canonical codes: by length, then by symbol
+    std::vector<uint32_t> codes(lengths.size(), 0);
+    uint32_t code = 0;
+    for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+        for (size_t s = 0; s < lengths.size(); s++) {
+            if (lengths[s] == length) codes[s] = code++;
+        }
+        code <<= 1;
+    }
+
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> offsets(blocks + 1, 0);
+    for (size_t b = 0; b < blocks; b++) {
+        uint64_t pending = 0;
+        int pendingBits = 0;
+        forEachSymbol(b, [&](int symbol) {
+            pending = (pending << lengths[symbol]) | codes[symbol];
+            pendingBits += lengths[symbol];
+            while (pendingBits >= 8) {
+                pendingBits -= 8;
+                data.push_back(static_cast<uint8_t>(pending >> pendingBits));
+            }
+        });
+        if (pendingBits) data.push_back(static_cast<uint8_t>(pending << (8 - pendingBits)));
+        if (data.size() > 0xFFFFFFFFu) return false;
+        offsets[b + 1] = static_cast<uint32_t>(data.size());
+    }
+
+    char header[HEADER_SIZE] = {'C', 'M', 'T', 'B'};
+    const uint32_t fields[3] = {TB_VERSION, static_cast<uint32_t>(pieces), BLOCK_ENTRIES};
+    const uint64_t entryCount = entries;
+    const uint32_t blockCount = static_cast<uint32_t>(blocks);
+    const uint16_t symbolCounts[2] = {static_cast<uint16_t>(valueSymbols), static_cast<uint16_t>(RUN_SYMBOLS)};
+    std::memcpy(header + 4, fields, sizeof(fields));
+    std::memcpy(header + 16, &entryCount, sizeof(entryCount));
+    std::memcpy(header + 24, &blockCount, sizeof(blockCount));
+    std::memcpy(header + 28, symbolCounts, sizeof(symbolCounts));
+
+    std::ofstream output(path, std::ios::binary);
+    output.write(header, sizeof(header));
+    output.write(reinterpret_cast<const char*>(lengths.data()), static_cast<std::streamsize>(lengths.size()));
+    const char padding[4] = {};
+    output.write(padding, static_cast<std::streamsize>((4 - (HEADER_SIZE + lengths.size()) % 4) % 4));
+    output.write(reinterpret_cast<const char*>(offsets.data()), static_cast<std::streamsize>(offsets.size() * 4));
+    output.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(output);
+}
+
+bool Tablebases::parseName(const std::string& name, std::vector<Piece>& pieces) {
+    pieces.clear();
+    size_t split = name.find('v');
+    if (split == std::string::npos) return false;
+
+    for (int side = 0; side < 2; side++) {
+        std::string letters = side == 0 ? name.substr(0, split) : name.substr(split + 1);
+        Color color = side == 0 ? WHITE : BLACK;
+        if (std::count(letters.begin(), letters.end(), 'K') != 1) return false;
+
+        std::vector<Piece> own;
+        for (char letter : letters) {
+            const char* found = std::strchr(PIECE_LETTERS, letter);
+            if (!found || letter == '\0') return false;
+            own.push_back(Piece(PIECE_ORDER[found - PIECE_LETTERS], color));
+        }
+        std::stable_sort(own.begin(), own.end(), [](const Piece& a, const Piece& b) {
+            return pieceRank(a.type) < pieceRank(b.type);
+        });
+        pieces.insert(pieces.end(), own.begin(), own.end());
+    }
+    return pieces.size() <= static_cast<size_t>(TB_MAX_PIECES);
+}
+
+std::string Tablebases::materialName(const Piece board[64]) {
+    std::string name;
+    for (Color color : {WHITE, BLACK}) {
+        if (color == BLACK) name += 'v';
+        for (int rank = 0; rank < 6; rank++) {
+            for (int sq = 0; sq < 64; sq++) {
+                if (board[sq].color == color && board[sq].type == PIECE_ORDER[rank]) {
+                    name += PIECE_LETTERS[rank];
+                }
+            }
+        }
+    }
+    return name;
+}
@@ -0,0 +1,180 @@
+// Endgame tablebases: exact distance to mate for positions with few
+// pieces, read from compressed table files that are mapped the first time a
+// search reaches their material
+#ifndef CHECKMATE_ENGINE_TABLEBASE_H
+#define CHECKMATE_ENGINE_TABLEBASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Pieces, kings included, that the tables cover
+const int TB_MAX_PIECES = 5;
+
+// The side to move's outcome with best play, and the plies to the mate
+struct TbResult {
+    int wdl;     // 1 win, 0 draw, -1 loss
+    int plies;
+};
+
+// The positions of one material, numbered for its table. Positions that
+// mirror into each other share a number: the white king is mirrored onto
+// the a-d files and, without pawns, into the a8-d8-d5 triangle. The two
+// kings are then one of their 462 placements apart (1806 with pawns), and
+// each group of like pieces is one set of squares, pawns counting only the
+// 48 they can stand on. Five pieces without pawns fit in 242 million
+// numbers, with pawns in 710 million.
+class TbIndex {
+public:
+    // pieces in the order parseName gives them
+    explicit TbIndex(const std::vector<Piece>& pieces);
+
+    size_t size() const { return entries; }
+    const std::vector<Piece>& getPieces() const { return pieces; }
+
+    // The number of the legal position with pieces[i] on squares[i]; like
+    // pieces may come in any order
+    size_t index(const int squares[], Color sideToMove) const;
+
+    // The position a number stands for. Some name none: pieces sharing a
+    // square, the side not to move in check, or a mirror image of another
+    // number's position, which index does not give back.
+    void position(size_t index, int squares[], Color& sideToMove) const;
+
+private:
+    // Like pieces in consecutive slots, and the number of sets they form
+    struct Group {
+        int first;
+        int count;
+        bool pawns;
+        size_t size;
+    };
+
+    std::vector<Piece> pieces;
+    std::vector<Group> groups;
+    bool pawns;
+    int blackKing;
+    size_t entries;
+    size_t groupEntries;
+
+    // The groups' part of the number, for mirrored squares
+    size_t groupIndex(const int squares[]) const;
+};
+
+// One file per material, named by it as in "KRvK.cmtb": White's pieces,
+// then Black's, each king first and the rest from queen down to pawn.
+// Positions with the colors reversed are looked up with the board
+// flipped. Layout:
+//
+//   char     magic[4]      "CMTB"
+//   uint32_t version       2
+//   uint32_t pieces        number of pieces, kings included
+//   uint32_t blockEntries  entries per block, a power of two
+//   uint64_t entries       the TbIndex size
+//   uint32_t blocks
+//   uint16_t valueSymbols
+//   uint16_t runSymbols
+//   uint8_t  lengths[valueSymbols + runSymbols]
+//   (zero padding to a multiple of 4)
+//   uint32_t offsets[blocks + 1]
+//   uint8_t  data[offsets[blocks]]
+//
+// Entry i is in block b = i / blockEntries, whose data runs from
+// offsets[b] to offsets[b + 1]. A block is a string of canonical Huffman
+// codes, most significant bit first, with lengths[] giving each symbol's
+// code length (zero for none). Symbol v below valueSymbols is the next
+// entry's value, and symbol valueSymbols + k repeats the last one 2^k more
+// times. Numbers with no position hold whatever lengthens a run. A value of
+// zero is a draw, and v > 0 is a result in v - 1 plies: a win when that is
+// odd, a loss when it is even.
+class Tablebases {
+public:
+    Tablebases();
+    ~Tablebases();
+
+    Tablebases(const Tablebases&) = delete;
+    Tablebases& operator=(const Tablebases&) = delete;
+
+    // Finds the table files in directory; none is mapped until probed.
+    // Not to be called while a search may be probing.
+    void setPath(const std::string& directory);
+
+    // Positions with more pieces than this are not probed; zero turns
+    // the tables off
+    void setPieceLimit(int pieces);
+    int getPieceLimit() const { return empty() ? 0 : pieceLimit; }
+
+    // Decode each table whole when it is first probed rather than one
+    // block per probe, for the table builder, which probes every position.
+    // Set before setPath.
+    void setUnpacked(bool unpacked) { unpack = unpacked; }
+
+    bool empty() const { return tables.empty(); }
+
+    // The result for the position, if a table covers it. Bare kings are a
+    // draw without one.
+    bool probe(const Piece board[64], Color sideToMove, TbResult& result) const;
+
+    // A table's pieces in index order, from its name; false if it is not a
+    // material the tables cover
+    static bool parseName(const std::string& name, std::vector<Piece>& pieces);
+
+    static std::string materialName(const Piece board[64]);
+
+    // The value of a number that names no position, which the writer
+    // stores as whatever compresses best
+    static const uint16_t NO_POSITION = 0xFFFF;
+
+    // Writes a table file of pieces pieces holding values, in TbIndex
+    // order and coded as the layout above describes
+    static bool writeTable(const std::string& path, int pieces, const std::vector<uint16_t>& values);
+
+private:
+    struct Table {
+        uint64_t material;
+        TbIndex positions;
+        std::string path;
+        std::once_flag mapped;
+        void* mapping;
+        size_t mappingSize;
+        bool unpack;
+
+        // The header's fields and the arrays inside the mapping
+        uint32_t blockEntries;
+        int valueSymbols;
+        const uint32_t* offsets;
+        const uint8_t* data;
+
+        // Canonical Huffman decoding: codes per length and the symbols
+        // ordered by code, and for the short codes the symbol and length
+        // straight from the next bits
+        std::vector<uint16_t> lengthCounts;
+        std::vector<uint16_t> sortedSymbols;
+        std::vector<uint32_t> shortCodes;
+
+        // Every value, when the table is unpacked
+        std::vector<uint16_t> values;
+
+        Table(uint64_t material, const std::vector<Piece>& pieces, const std::string& path);
+
+        // Decodes block up to its entry last, copying the values into out
+        // if set; false for data the codes do not fit
+        bool decode(size_t block, size_t last, uint16_t* out, int& value) const;
+        bool valueAt(size_t index, int& value) const;
+    };
+
+    std::vector<std::unique_ptr<Table>> tables;
+    int pieceLimit;
+    bool unpack;
+
+    Table* find(uint64_t material) const;
+    static void mapTable(Table& table);
+    void clear();
+};
+
+#endif // CHECKMATE_ENGINE_TABLEBASE_H
@@ -0,0 +1,149 @@
+#include "tt.h"
+
+#include <algorithm>
+#include <limits>
+#include <new>
+
+#include "log.h"
+
+namespace {
+
+// Packed entry data: move (bits 0-15), score (16-31), depth (32-39),
+// bound (40-41) and generation (42-47)
+const int GENERATION_BITS = 6;
+const int GENERATION_MASK = (1 << GENERATION_BITS) - 1;
+
+uint64_t packEntry(Move move, int score, int depth, Bound bound, uint8_t generation) {
+    return static_cast<uint64_t>(move.data)
+         | (static_cast<uint64_t>(static_cast<uint16_t>(static_cast<int16_t>(score))) << 16)
+         | (static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 32)
+         | (static_cast<uint64_t>(bound) << 40)
+         | (static_cast<uint64_t>(generation & GENERATION_MASK) << 42);
+}
+
+Move entryMove(uint64_t data) { return Move::fromData(static_cast<uint16_t>(data)); }
+int entryScore(uint64_t data) { return static_cast<int16_t>(data >> 16); }
+int entryDepth(uint64_t data) { return static_cast<uint8_t>(data >> 32); }
+Bound entryBound(uint64_t data) { return static_cast<Bound>((data >> 40) & 3); }
+int entryGeneration(uint64_t data) { return static_cast<int>((data >> 42) & GENERATION_MASK); }
+
+// Mate scores are stored relative to the node so they stay valid when
+// the same position is reached at a different ply
+int scoreToTT(int score, int ply) {
+    if (score > MATE_BOUND) return score + ply;
+    if (score < -MATE_BOUND) return score - ply;
+    return score;
+}
+
+int scoreFromTT(int score, int ply) {
+    if (score > MATE_BOUND) return score - ply;
+    if (score < -MATE_BOUND) return score + ply;
+    return score;
+}
+
+} // namespace
+
+TranspositionTable::TranspositionTable(int megabytes) : bucketCount(0), generation(0) {
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(int megabytes) {
+    megabytes = std::max(1, std::min(megabytes, MAX_SIZE_MB));
+
+    size_t count = 1;
+    while (count * 2 * sizeof(TTBucket) <= (static_cast<size_t>(megabytes) << 20)) count *= 2;
+
+    buckets.reset();
+    bucketCount = 0;
+    while (count > 0) {
+        buckets.reset(new (std::nothrow) TTBucket[count]);
+        if (buckets) break;
+        LOGE("Transposition table allocation of %zu buckets failed, halving", count);
+        count /= 2;
+    }
+    bucketCount = count;
+    clear();
+    LOGD("Transposition table resized to %d MB", sizeMB());
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < bucketCount; i++) {
+        for (TTEntry& entry : buckets[i].entries) {
+            entry.keyXorData.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation.store(0, std::memory_order_relaxed);
+}
+
+void TranspositionTable::newSearch() {
+    generation.store((generation.load(std::memory_order_relaxed) + 1) & GENERATION_MASK,
+                     std::memory_order_relaxed);
+}
+
+bool TranspositionTable::probe(uint64_t key, int ply, TTHit& hit) const {
+    if (!bucketCount) return false;
+
+    const TTBucket& bucket = bucketFor(key);
+    for (const TTEntry& entry : bucket.entries) {
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        uint64_t keyXorData = entry.keyXorData.load(std::memory_order_relaxed);
+        if ((keyXorData ^ data) != key || entryBound(data) == BOUND_NONE) continue;
+
+        hit.move = entryMove(data);
+        hit.score = scoreFromTT(entryScore(data), ply);
+        hit.depth = entryDepth(data);
+        hit.bound = entryBound(data);
+        return true;
+    }
+    return false;
+}
+
+// Replacement: the same position is overwritten unless that would trade an
+// exact or much deeper result for a shallow bound. Otherwise the entry
+// that is shallowest, counting each search of age as eight plies, goes.
+void TranspositionTable::store(uint64_t key, int ply, Move move, int score, int depth, Bound bound) {
+    if (!bucketCount) return;
+
+    TTBucket& bucket = bucketFor(key);
+    TTEntry* victim = &bucket.entries[0];
+    int victimWorth = std::numeric_limits<int>::max();
+    int currentGeneration = generation.load(std::memory_order_relaxed);
+
+    for (TTEntry& entry : bucket.entries) {
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        uint64_t keyXorData = entry.keyXorData.load(std::memory_order_relaxed);
+        if ((keyXorData ^ data) == key && entryBound(data) != BOUND_NONE) {
+            bool fresh = entryGeneration(data) == currentGeneration;
+            if (fresh && bound != BOUND_EXACT && depth + 2 < entryDepth(data)) return;
+            // Keep the old best move when this result has none
+            if (move.isNull()) move = entryMove(data);
+            victim = &entry;
+            break;
+        }
+
+        int age = (currentGeneration - entryGeneration(data)) & GENERATION_MASK;
+        int worth = entryBound(data) == BOUND_NONE ? -1 : entryDepth(data) - 8 * age;
+        if (worth < victimWorth) {
+            victimWorth = worth;
+            victim = &entry;
+        }
+    }
+
+    uint64_t data = packEntry(move, scoreToTT(score, ply), std::max(0, depth), bound, static_cast<uint8_t>(currentGeneration));
+    victim->data.store(data, std::memory_order_relaxed);
+    victim->keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = std::min<size_t>(bucketCount, 1000 / TT_BUCKET_SIZE);
+    int current = generation.load(std::memory_order_relaxed);
+    int used = 0;
+    for (size_t i = 0; i < sample; i++) {
+        for (const TTEntry& entry : buckets[i].entries) {
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+            if (entryBound(data) != BOUND_NONE && entryGeneration(data) == current) used++;
+        }
+    }
+    return sample ? static_cast<int>(used * 1000 / (sample * TT_BUCKET_SIZE)) : 0;
+}
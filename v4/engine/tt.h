@@ -0,0 +1,73 @@
+// Transposition table: search results keyed by Zobrist hash
+#ifndef CHECKMATE_ENGINE_TT_H
+#define CHECKMATE_ENGINE_TT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "types.h"
+
+enum Bound {
+    BOUND_NONE = 0,
+    BOUND_UPPER = 1,   // score is at most this (failed low)
+    BOUND_LOWER = 2,   // score is at least this (failed high)
+    BOUND_EXACT = 3
+};
+
+// What a probe hands back. Mate scores are already relative to the root.
+struct TTHit {
+    Move move;
+    int score;
+    int depth;
+    Bound bound;
+};
+
+// One 16-byte slot shared by all search threads. The key is stored xor'ed
+// with the data, so an entry torn by two threads writing at once simply
+// fails to match any key. Relaxed atomics compile to plain loads and stores.
+struct TTEntry {
+    std::atomic<uint64_t> keyXorData;
+    std::atomic<uint64_t> data;
+};
+
+const int TT_BUCKET_SIZE = 4;
+
+// Four entries per 64-byte cache line, so a probe touches one line
+struct alignas(64) TTBucket {
+    TTEntry entries[TT_BUCKET_SIZE];
+};
+
+class TranspositionTable {
+public:
+    static constexpr int DEFAULT_SIZE_MB = 16;
+    static constexpr int MAX_SIZE_MB = 1024;
+
+    explicit TranspositionTable(int megabytes = DEFAULT_SIZE_MB);
+
+    // Reallocates to the largest power-of-two bucket count that fits in
+    // megabytes, halving on allocation failure. Clears the table.
+    void resize(int megabytes);
+    void clear();
+
+    // Ages out results from earlier searches for replacement purposes
+    void newSearch();
+
+    bool probe(uint64_t key, int ply, TTHit& hit) const;
+    void store(uint64_t key, int ply, Move move, int score, int depth, Bound bound);
+
+    int sizeMB() const { return static_cast<int>((bucketCount * sizeof(TTBucket)) >> 20); }
+
+    // Permille of sampled entries written during the current search
+    int hashfull() const;
+
+private:
+    std::unique_ptr<TTBucket[]> buckets;
+    size_t bucketCount;
+    std::atomic<uint8_t> generation;
+
+    TTBucket& bucketFor(uint64_t key) const { return buckets[key & (bucketCount - 1)]; }
+};
+
+#endif // CHECKMATE_ENGINE_TT_H
@@ -0,0 +1,188 @@
+// Core value types shared by the whole engine: pieces, moves, move lists
+#ifndef CHECKMATE_ENGINE_TYPES_H
+#define CHECKMATE_ENGINE_TYPES_H
+
+#include <cstdint>
+#include <string>
+
+enum PieceType {
+    EMPTY = 0,
+    PAWN = 1,
+    KNIGHT = 2,
+    BISHOP = 3,
+    ROOK = 4,
+    QUEEN = 5,
+    KING = 6
+};
+
+enum Color {
+    NONE = 0,
+    WHITE = 1,
+    BLACK = 2
+};
+
+struct Piece {
+    PieceType type;
+    Color color;
+
+    Piece() : type(EMPTY), color(NONE) {}
+    Piece(PieceType t, Color c) : type(t), color(c) {}
+};
+
+// Move flags, stored in the top four bits of a Move. Bit 2 marks a capture
+// and bit 3 a promotion, whose piece is KNIGHT + (flags & 3).
+enum MoveFlag {
+    QUIET = 0,
+    DOUBLE_PUSH = 1,
+    KING_CASTLE = 2,
+    QUEEN_CASTLE = 3,
+    CAPTURE = 4,
+    EN_PASSANT = 5,
+    PROMOTION = 8,
+    PROMOTION_CAPTURE = 12
+};
+
+// A move packed into 16 bits: from square (bits 0-5), to square (bits 6-11)
+// and flags (bits 12-15). The all-zero value is the null move.
+struct Move {
+    uint16_t data;
+
+    Move() = default;
+    Move(int from, int to, int flags)
+        : data(static_cast<uint16_t>(from | (to << 6) | (flags << 12))) {}
+
+    static Move none() { return Move(0, 0, 0); }
+
+    static Move fromData(uint16_t data) {
+        Move move;
+        move.data = data;
+        return move;
+    }
+
+    int from() const { return data & 0x3F; }
+    int to() const { return (data >> 6) & 0x3F; }
+    int flags() const { return data >> 12; }
+
+    bool isNull() const { return data == 0; }
+    bool isCapture() const { return (flags() & CAPTURE) != 0; }
+    bool isPromotion() const { return (flags() & PROMOTION) != 0; }
+    bool isEnPassant() const { return flags() == EN_PASSANT; }
+    bool isCastling() const { return flags() == KING_CASTLE || flags() == QUEEN_CASTLE; }
+    PieceType promotionType() const { return static_cast<PieceType>(KNIGHT + (flags() & 3)); }
+
+    bool operator==(const Move& other) const { return data == other.data; }
+    bool operator!=(const Move& other) const { return data != other.data; }
+};
+
+// Coordinate notation such as "e2e4" or "e7e8q"
+inline std::string moveToString(const Move& move) {
+    if (move.isNull()) return "0000";
+    std::string text;
+    text += static_cast<char>('a' + (move.from() & 7));
+    text += static_cast<char>('8' - (move.from() >> 3));
+    text += static_cast<char>('a' + (move.to() & 7));
+    text += static_cast<char>('8' - (move.to() >> 3));
+    if (move.isPromotion()) text += " nbrq"[move.promotionType() - PAWN];
+    return text;
+}
+
+// No reachable position has more than 218 legal moves
+const int MAX_MOVES = 256;
+
+// Fixed-capacity move buffer that lives on the stack, so generating moves
+// inside the search never touches the heap. Ordering scores are kept in a
+// parallel array so the moves themselves stay two bytes each.
+struct MoveList {
+    Move moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    int count;
+
+    MoveList() : count(0) {}
+
+    void add(Move move) { moves[count++] = move; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    Move& operator[](int i) { return moves[i]; }
+    const Move& operator[](int i) const { return moves[i]; }
+
+    Move* begin() { return moves; }
+    Move* end() { return moves + count; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + count; }
+
+    // Insertion sort on scores, highest first; lists are short enough that
+    // this beats std::sort and keeps moves and scores in step.
+    void sortByScore() {
+        for (int i = 1; i < count; i++) {
+            Move move = moves[i];
+            int score = scores[i];
+            int j = i - 1;
+            while (j >= 0 && scores[j] < score) {
+                moves[j + 1] = moves[j];
+                scores[j + 1] = scores[j];
+                j--;
+            }
+            moves[j + 1] = move;
+            scores[j + 1] = score;
+        }
+    }
+};
+
+// Bitboards: bit (row * 8 + col) is set for each occupied square, so a8 is
+// bit 0 and h1 is bit 63, matching the row/col layout used by the UI.
+typedef uint64_t Bitboard;
+
+enum CastlingRight {
+    WHITE_KINGSIDE = 1,
+    WHITE_QUEENSIDE = 2,
+    BLACK_KINGSIDE = 4,
+    BLACK_QUEENSIDE = 8,
+    ALL_CASTLING = 15
+};
+
+// Castling rights that survive a move from or to sq
+inline int castlingRightsKept(int sq) {
+    switch (sq) {
+        case 0:  return ALL_CASTLING & ~BLACK_QUEENSIDE;                   // a8
+        case 4:  return ALL_CASTLING & ~(BLACK_KINGSIDE | BLACK_QUEENSIDE); // e8
+        case 7:  return ALL_CASTLING & ~BLACK_KINGSIDE;                    // h8
+        case 56: return ALL_CASTLING & ~WHITE_QUEENSIDE;                   // a1
+        case 60: return ALL_CASTLING & ~(WHITE_KINGSIDE | WHITE_QUEENSIDE); // e1
+        case 63: return ALL_CASTLING & ~WHITE_KINGSIDE;                    // h1
+        default: return ALL_CASTLING;
+    }
+}
+
+// Deepest line the search can play out from the root
+const int MAX_PLY = 128;
+
+// Score for giving mate on the spot; mate in n plies scores MATE_SCORE - n
+const int MATE_SCORE = 30000;
+
+// Scores beyond this are mate scores rather than evaluations
+const int MATE_BOUND = MATE_SCORE - MAX_PLY;
+
+// Outside every reachable score, and still fits the table's 16 bits
+const int INFINITE_SCORE = 32000;
+
+// Half-width of the first aspiration window around the previous score
+const int ASPIRATION_WINDOW = 35;
+
+// Undo entries kept for game moves plus the current search line
+const int MAX_UNDO = 1024;
+
+// Which moves a generator call should produce. Captures also include
+// queen promotions; quiets include castling and underpromotions.
+enum GenType {
+    GEN_CAPTURES,
+    GEN_QUIETS,
+    GEN_ALL
+};
+
+struct CheckInfo {
+    Bitboard checkers;
+    Bitboard pinned;
+};
+
+#endif // CHECKMATE_ENGINE_TYPES_H
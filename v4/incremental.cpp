@@ -0,0 +1,204 @@
+// Incremental state self-test. Plays seeded random games from a set of
+// positions and, after every makeMove and every unmakeMove on the way back,
+// checks that the hash, pawn key and piece-square scores kept move by move
+// match the same terms recomputed from the board.
+//
+//   incremental                 run the built-in positions
+//   incremental --fen FEN       play from one position
+//   incremental --nnue FILE     also check the network: writes one of
+//                               random weights to FILE and plays with it
+//
+// With a network the accumulator updated by the SIMD kernels has to match
+// one rebuilt by the plain kernels, and so do the evaluations. Options:
+// --playouts N games per position, --plies N moves per game and --seed N
+// for the move choice and the weights.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "engine/chess_game.h"
+#include "engine/nnue.h"
+
+namespace {
+
+// Castling both ways, en passant, promotions and pins, and a bare endgame
+const char* const testPositions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "8/1P4k1/8/8/8/8/6p1/4K3 w - - 0 1",
+};
+
+struct PlayoutOptions {
+    int playouts = 20;
+    int plies = 200;
+    unsigned seed = 1;
+};
+
+// A network in the CMNN layout nnue.h describes. Feature weights are small
+// and the biases centred inside the clipping range, so with a board's worth
+// of pieces hidden values land below zero, inside and above 255 alike.
+bool writeRandomNetwork(const std::string& path, std::mt19937& rng) {
+    std::vector<int16_t> weights(NNUE_INPUTS * NNUE_HIDDEN + NNUE_HIDDEN + 2 * NNUE_HIDDEN);
+    size_t bias = static_cast<size_t>(NNUE_INPUTS) * NNUE_HIDDEN;
+    for (size_t i = 0; i < weights.size(); i++) {
+        int value = static_cast<int>(rng() % 129) - 64;
+        if (i >= bias && i < bias + NNUE_HIDDEN) value += 128;
+        weights[i] = static_cast<int16_t>(value);
+    }
+    int32_t outputBias = static_cast<int32_t>(rng() % 20001) - 10000;
+
+    char header[64] = {'C', 'M', 'N', 'N'};
+    const uint32_t fields[3] = {1, static_cast<uint32_t>(NNUE_INPUTS), static_cast<uint32_t>(NNUE_HIDDEN)};
+    std::memcpy(header + 4, fields, sizeof(fields));
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(header, sizeof(header));
+    out.write(reinterpret_cast<const char*>(weights.data()), static_cast<std::streamsize>(weights.size() * sizeof(int16_t)));
+    out.write(reinterpret_cast<const char*>(&outputBias), sizeof(outputBias));
+    return static_cast<bool>(out);
+}
+
+// Empty when everything matches, otherwise what did not
+std::string verify(const ChessGame& game) {
+    if (game.getHash() != game.computeHash()) return "hash";
+    return game.verifyIncremental();
+}
+
+void report(const char* fen, int playout, int ply, const char* step, const Move& move, const std::string& what) {
+    std::printf("  FAILED: %s after %s %s, playout %d ply %d from %s\n", what.c_str(), step,
+                moveToString(move).c_str(), playout, ply, fen);
+}
+
+// Plays options.playouts random games from fen, each as far as options.plies
+// or the end of the game, checking the way out and the way back. Returns
+// the number of failures and adds the positions checked to checked.
+int runPosition(const char* fen, const NnueNetwork* network, const PlayoutOptions& options, std::mt19937& rng,
+                uint64_t& checked) {
+    ChessGame game;
+    if (!game.setFromFen(fen)) {
+        std::printf("  FAILED: invalid FEN %s\n", fen);
+        return 1;
+    }
+    game.setNetwork(network);
+    std::string start = verify(game);
+    if (!start.empty()) {
+        std::printf("  FAILED: %s after loading %s\n", start.c_str(), fen);
+        return 1;
+    }
+
+    int failures = 0;
+    std::vector<Move> played;
+    std::vector<uint64_t> hashes;
+    for (int playout = 0; playout < options.playouts; playout++) {
+        played.clear();
+        hashes.clear();
+        for (int ply = 0; ply < options.plies; ply++) {
+            MoveList moves;
+            game.generateLegalMoves(moves);
+            if (moves.empty()) break;
+
+            Move move = moves[static_cast<int>(rng() % static_cast<unsigned>(moves.size()))];
+            hashes.push_back(game.getHash());
+            game.makeMove(move);
+            played.push_back(move);
+            checked++;
+
+            std::string what = verify(game);
+            if (!what.empty()) {
+                report(fen, playout, ply, "making", move, what);
+                failures++;
+                break;
+            }
+        }
+
+        // Back to the start, which must look exactly as it did
+        while (!played.empty()) {
+            Move move = played.back();
+            game.unmakeMove();
+            played.pop_back();
+            checked++;
+
+            std::string what = verify(game);
+            if (what.empty() && game.getHash() != hashes[played.size()]) what = "hash before the move";
+            if (!what.empty()) {
+                report(fen, playout, static_cast<int>(played.size()), "unmaking", move, what);
+                failures++;
+                break;
+            }
+        }
+        if (!played.empty()) {
+            // Left mid-game by a failure; the rest would only repeat it
+            break;
+        }
+    }
+    return failures;
+}
+
+void printUsage() {
+    std::printf("usage: incremental [--fen FEN] [--nnue FILE] [--playouts N] [--plies N] [--seed N]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    PlayoutOptions options;
+    std::string fen;
+    std::string networkPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--fen" && hasValue) {
+            fen = argv[++i];
+        } else if (arg == "--nnue" && hasValue) {
+            networkPath = argv[++i];
+        } else if (arg == "--playouts" && hasValue) {
+            options.playouts = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--plies" && hasValue) {
+            options.plies = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    std::vector<const char*> positions;
+    if (!fen.empty()) {
+        positions.push_back(fen.c_str());
+    } else {
+        positions.assign(std::begin(testPositions), std::end(testPositions));
+    }
+
+    std::mt19937 rng(options.seed);
+    NnueNetwork network;
+    if (!networkPath.empty() && (!writeRandomNetwork(networkPath, rng) || !network.load(networkPath))) {
+        std::fprintf(stderr, "cannot write and load a network at %s\n", networkPath.c_str());
+        return 2;
+    }
+
+    int failures = 0;
+    uint64_t checked = 0;
+    for (const char* position : positions) {
+        failures += runPosition(position, networkPath.empty() ? nullptr : &network, options, rng, checked);
+    }
+
+    std::printf("positions %zu  playouts %d  evaluation %s  checked %llu\n", positions.size(), options.playouts,
+                networkPath.empty() ? "piece-square tables" : "network", static_cast<unsigned long long>(checked));
+    std::printf("%s\n", failures ? "incremental check FAILED" : "incremental check passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+// Builds an opening book for OpeningBook from lines of play. Each input
+// line is one game or variation from the starting position, in coordinate
+// notation: "e2e4 e7e5 g1f3 b8c6". Every move counts once towards its
+// weight in the position it was played from.
+//
+//   makebook INPUT OUTPUT [--plies N] [--min-count N]
+//
+// --plies stops each line after N moves (default 16); --min-count drops
+// moves played fewer than N times (default 1). Blank lines and lines
+// starting with '#' are skipped.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "engine/book.h"
+#include "engine/chess_game.h"
+
+namespace {
+
+Move findMove(ChessGame& game, const std::string& text) {
+    MoveList moves;
+    game.generateLegalMoves(moves);
+    for (const Move& move : moves) {
+        if (moveToString(move) == text) return move;
+    }
+    return Move::none();
+}
+
+void printUsage() {
+    std::printf("usage: makebook INPUT OUTPUT [--plies N] [--min-count N]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths;
+    int maxPlies = 16;
+    int minCount = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--plies" && hasValue) {
+            maxPlies = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--min-count" && hasValue) {
+            minCount = std::max(1, std::atoi(argv[++i]));
+        } else if (arg.compare(0, 2, "--") != 0 && paths.size() < 2) {
+            paths.push_back(arg);
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (paths.size() != 2) {
+        printUsage();
+        return 2;
+    }
+
+    std::ifstream input(paths[0]);
+    if (!input) {
+        std::fprintf(stderr, "cannot read %s\n", paths[0].c_str());
+        return 1;
+    }
+
+    // Counts by position key, then packed move
+    std::map<std::pair<uint64_t, uint16_t>, unsigned> counts;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(input, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') continue;
+
+        ChessGame game;
+        std::istringstream words(line);
+        std::string word;
+        for (int ply = 0; ply < maxPlies && words >> word; ply++) {
+            Move move = findMove(game, word);
+            if (move.isNull()) {
+                std::fprintf(stderr, "line %d: illegal move %s, rest of line skipped\n", lineNumber, word.c_str());
+                break;
+            }
+            counts[{game.getHash(), OpeningBook::packMove(move)}]++;
+            game.makeMove(move);
+        }
+    }
+
+    // The map is already in key order, as the book needs
+    std::vector<BookEntry> entries;
+    for (const auto& count : counts) {
+        if (count.second < static_cast<unsigned>(minCount)) continue;
+        BookEntry entry;
+        entry.key = count.first.first;
+        entry.move = count.first.second;
+        entry.weight = static_cast<uint16_t>(std::min(count.second, 65535u));
+        entry.reserved = 0;
+        entries.push_back(entry);
+    }
+
+    std::ofstream output(paths[1], std::ios::binary);
+    char header[16] = {'C', 'M', 'B', 'K'};
+    uint32_t version = 1;
+    uint32_t entryCount = static_cast<uint32_t>(entries.size());
+    std::memcpy(header + 4, &version, sizeof(version));
+    std::memcpy(header + 8, &entryCount, sizeof(entryCount));
+    output.write(header, sizeof(header));
+    output.write(reinterpret_cast<const char*>(entries.data()),
+                 static_cast<std::streamsize>(entries.size() * sizeof(BookEntry)));
+    if (!output) {
+        std::fprintf(stderr, "cannot write %s\n", paths[1].c_str());
+        return 1;
+    }
+
+    std::printf("%zu positions and moves from %d lines\n", entries.size(), lineNumber);
+    return 0;
+}
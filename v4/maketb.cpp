@@ -0,0 +1,516 @@
+// Builds endgame tables for Tablebases by retrograde analysis: positions
+// mated now, then those winning or losing one ply later, and so on until
+// nothing changes. What is left is drawn.
+//
+//   maketb [--verify] DIRECTORY NAME...   e.g. maketb tb KQvK KRvK KBvK KNvK KPvK
+//
+// Captures and promotions lead into other tables, which are read from
+// DIRECTORY, so build those first: KPvK needs the four tables before it.
+// --verify reads each table back through Tablebases and checks every
+// position against the results of its moves, generated by ChessGame.
+//
+// A ply is found by unmaking moves from the positions decided one ply
+// earlier, so each layer visits only the positions next to the last. The
+// builder keeps four bytes per position: 1 GB for five pieces without
+// pawns, 2.8 GB with them.
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "engine/bitboard.h"
+#include "engine/chess_game.h"
+#include "engine/tablebase.h"
+
+namespace {
+
+// Not a loss whatever the moves inside the table do: a move out of it
+// draws or wins
+const uint16_t CANNOT_LOSE = 0xFFFF;
+
+Bitboard attacksFrom(const Piece& piece, int sq, Bitboard occupied) {
+    switch (piece.type) {
+        case PAWN: return pawnAttacks[piece.color][sq];
+        case KNIGHT: return knightAttacks[sq];
+        case BISHOP: return bishopAttacks(sq, occupied);
+        case ROOK: return rookAttacks(sq, occupied);
+        case QUEEN: return queenAttacks(sq, occupied);
+        case KING: return kingAttacks[sq];
+        default: return 0;
+    }
+}
+
+std::string fenOf(const Piece board[64], Color sideToMove) {
+    std::string fen;
+    for (int row = 0; row < 8; row++) {
+        int empty = 0;
+        for (int col = 0; col < 8; col++) {
+            const Piece& piece = board[squareOf(row, col)];
+            if (piece.type == EMPTY) {
+                empty++;
+                continue;
+            }
+            if (empty) fen += static_cast<char>('0' + empty);
+            empty = 0;
+            char letter = " pnbrqk"[piece.type];
+            fen += piece.color == WHITE ? static_cast<char>(letter - 'a' + 'A') : letter;
+        }
+        if (empty) fen += static_cast<char>('0' + empty);
+        if (row < 7) fen += '/';
+    }
+    fen += sideToMove == WHITE ? " w - - 0 1" : " b - - 0 1";
+    return fen;
+}
+
+void readBoard(ChessGame& game, Piece board[64]) {
+    for (int sq = 0; sq < 64; sq++) {
+        int code = game.getPiece(rowOf(sq), colOf(sq));
+        board[sq] = code ? Piece(static_cast<PieceType>(code % 10), static_cast<Color>(code / 10)) : Piece();
+    }
+}
+
+// A table's values as Tablebases stores them: zero for a draw, otherwise
+// the plies to the mate plus one
+uint16_t valueOf(const TbResult& result) {
+    return result.wdl == 0 ? 0 : static_cast<uint16_t>(result.plies + 1);
+}
+
+bool isWin(uint16_t value) {
+    return value != 0 && value != Tablebases::NO_POSITION && ((value - 1) & 1);
+}
+
+class Builder {
+public:
+    Builder(const std::vector<Piece>& pieces, const Tablebases& sources)
+        : positions(pieces), pieces(pieces), count(static_cast<int>(pieces.size())), sources(sources) {
+        for (int i = 0; i < count; i++) {
+            if (pieces[i].type == KING && pieces[i].color == BLACK) blackKing = i;
+        }
+    }
+
+    // Fills values; false, with the reason on stderr, if a table it leads
+    // into is missing
+    bool build(const std::string& name);
+
+    const std::vector<uint16_t>& getValues() const { return values; }
+    int getLongest() const { return longest; }
+
+private:
+    TbIndex positions;
+    const std::vector<Piece>& pieces;
+    int count;
+    int blackKing = 0;
+    const Tablebases& sources;
+
+    std::vector<uint16_t> values;
+    // The longest loss a move out of the table leads to, plus one, or
+    // CANNOT_LOSE
+    std::vector<uint16_t> lossFloor;
+    // Positions found by the last ply, one list per ply for those that
+    // moves out of the table decide later
+    std::vector<std::vector<uint32_t>> scheduled;
+    int longest = 0;
+
+    int kingOf(Color side) const { return side == WHITE ? 0 : blackKing; }
+
+    Bitboard occupancy(const int squares[], int skip = -1) const {
+        Bitboard occupied = 0;
+        for (int i = 0; i < count; i++) {
+            if (i != skip) occupied |= squareBB(squares[i]);
+        }
+        return occupied;
+    }
+
+    // Whether by attacks target, not counting the piece in slot skip
+    bool attacked(const int squares[], int target, Color by, Bitboard occupied, int skip) const {
+        for (int i = 0; i < count; i++) {
+            if (i == skip || pieces[i].color != by) continue;
+            if (attacksFrom(pieces[i], squares[i], occupied) & squareBB(target)) return true;
+        }
+        return false;
+    }
+
+    // The result of a move that leaves the table, from the opponent's side
+    bool probeOutside(const int after[], int moved, int captured, PieceType promotion, Color toMove,
+                      TbResult& result) const {
+        Piece board[64];
+        for (int i = 0; i < count; i++) {
+            if (i == captured) continue;
+            board[after[i]] = i == moved && promotion != EMPTY ? Piece(promotion, pieces[i].color) : pieces[i];
+        }
+        if (sources.probe(board, toMove, result)) return true;
+        std::fprintf(stderr, "build %s first\n", Tablebases::materialName(board).c_str());
+        return false;
+    }
+
+    // Calls visit(after, moved, captured, promotion) for each legal move of
+    // side, captured being -1 and promotion EMPTY for a move that stays in
+    // the table. visit returns false to stop, and then so does this.
+    template <typename Visit>
+    bool forEachMove(const int squares[], Color side, Visit visit) const {
+        Bitboard occupied = occupancy(squares);
+        Bitboard own = 0;
+        for (int i = 0; i < count; i++) {
+            if (pieces[i].color == side) own |= squareBB(squares[i]);
+        }
+
+        int after[TB_MAX_PIECES];
+        for (int i = 0; i < count; i++) {
+            const Piece& piece = pieces[i];
+            if (piece.color != side) continue;
+            int from = squares[i];
+            Bitboard targets;
+            if (piece.type == PAWN) {
+                int forward = side == WHITE ? -8 : 8;
+                targets = pawnAttacks[side][from] & occupied & ~own;
+                if (!(occupied & squareBB(from + forward))) {
+                    targets |= squareBB(from + forward);
+                    bool start = rowOf(from) == (side == WHITE ? 6 : 1);
+                    if (start && !(occupied & squareBB(from + 2 * forward))) targets |= squareBB(from + 2 * forward);
+                }
+            } else {
+                targets = attacksFrom(piece, from, occupied) & ~own;
+            }
+
+            while (targets) {
+                int to = popLsb(targets);
+                int captured = -1;
+                for (int j = 0; j < count; j++) {
+                    if (squares[j] == to) captured = j;
+                }
+                std::copy(squares, squares + count, after);
+                after[i] = to;
+                Bitboard occupiedAfter = (occupied ^ squareBB(from)) | squareBB(to);
+                if (attacked(after, after[kingOf(side)], opposite(side), occupiedAfter, captured)) continue;
+
+                if (piece.type != PAWN || (rowOf(to) != 0 && rowOf(to) != 7)) {
+                    if (!visit(after, i, captured, EMPTY)) return false;
+                    continue;
+                }
+                for (PieceType promotion : {QUEEN, ROOK, BISHOP, KNIGHT}) {
+                    if (!visit(after, i, captured, promotion)) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Calls visit(before) for each position inside the table that has a
+    // move to this one. Whether the side not to move is in check there is
+    // left to its entry.
+    template <typename Visit>
+    void forEachUnmove(const int squares[], Color sideToMove, Visit visit) const {
+        Color mover = opposite(sideToMove);
+        Bitboard occupied = occupancy(squares);
+        int before[TB_MAX_PIECES];
+        for (int i = 0; i < count; i++) {
+            const Piece& piece = pieces[i];
+            if (piece.color != mover) continue;
+            int to = squares[i];
+            Bitboard origins;
+            if (piece.type == PAWN) {
+                int back = mover == WHITE ? 8 : -8;
+                origins = 0;
+                int from = to + back;
+                if (rowOf(from) >= 1 && rowOf(from) <= 6 && !(occupied & squareBB(from))) {
+                    origins |= squareBB(from);
+                    bool pushedTwo = rowOf(to) == (mover == WHITE ? 4 : 3);
+                    if (pushedTwo && !(occupied & squareBB(from + back))) origins |= squareBB(from + back);
+                }
+            } else {
+                origins = attacksFrom(piece, to, occupied) & ~occupied;
+                // Kings never stand next to each other
+                if (piece.type == KING) origins &= ~kingAttacks[squares[kingOf(sideToMove)]];
+            }
+
+            while (origins) {
+                std::copy(squares, squares + count, before);
+                before[i] = popLsb(origins);
+                visit(before);
+            }
+        }
+    }
+
+    bool initialise();
+    uint16_t lossDistance(size_t index) const;
+};
+
+// Every number's position checked and its moves out of the table probed.
+// Positions with no moves are decided here, the rest scheduled for the ply
+// the moves out of the table decide them at.
+bool Builder::initialise() {
+    size_t size = positions.size();
+    values.assign(size, 0);
+    lossFloor.assign(size, 0);
+    scheduled.assign(2, std::vector<uint32_t>());
+
+    int squares[TB_MAX_PIECES];
+    for (size_t index = 0; index < size; index++) {
+        Color sideToMove;
+        positions.position(index, squares, sideToMove);
+        Bitboard occupied = occupancy(squares);
+        if (popCount(occupied) != count || positions.index(squares, sideToMove) != index ||
+            attacked(squares, squares[kingOf(opposite(sideToMove))], sideToMove, occupied, -1)) {
+            values[index] = Tablebases::NO_POSITION;
+            continue;
+        }
+
+        bool anyMove = false, insideMove = false, canLose = true, missing = false;
+        int fastestWin = INT_MAX, slowestLoss = 0;
+        forEachMove(squares, sideToMove, [&](const int after[], int moved, int captured, PieceType promotion) {
+            anyMove = true;
+            if (captured < 0 && promotion == EMPTY) {
+                insideMove = true;
+                return true;
+            }
+            TbResult result;
+            if (!probeOutside(after, moved, captured, promotion, opposite(sideToMove), result)) {
+                missing = true;
+                return false;
+            }
+            if (result.wdl < 0) fastestWin = std::min(fastestWin, result.plies + 1);
+            if (result.wdl <= 0) canLose = false;
+            if (result.wdl > 0) slowestLoss = std::max(slowestLoss, result.plies + 1);
+            return true;
+        });
+        if (missing) return false;
+
+        if (!anyMove) {
+            // Mated is a loss in zero plies; stalemate stays a draw
+            if (attacked(squares, squares[kingOf(sideToMove)], opposite(sideToMove), occupied, -1)) {
+                values[index] = valueOf(TbResult{-1, 0});
+                scheduled[0].push_back(static_cast<uint32_t>(index));
+            }
+            continue;
+        }
+
+        lossFloor[index] = canLose ? static_cast<uint16_t>(slowestLoss) : CANNOT_LOSE;
+        int decidedAt = fastestWin != INT_MAX ? fastestWin : !insideMove && canLose ? slowestLoss : -1;
+        if (decidedAt >= 0) {
+            if (static_cast<size_t>(decidedAt) >= scheduled.size()) scheduled.resize(decidedAt + 1);
+            scheduled[decidedAt].push_back(static_cast<uint32_t>(index));
+        }
+    }
+    return true;
+}
+
+// The plies to the mate if every move loses, or zero while one does not
+// lose yet
+uint16_t Builder::lossDistance(size_t index) const {
+    if (lossFloor[index] == CANNOT_LOSE) return 0;
+
+    int squares[TB_MAX_PIECES];
+    Color sideToMove;
+    positions.position(index, squares, sideToMove);
+    uint16_t distance = lossFloor[index];
+    bool allWin = forEachMove(squares, sideToMove, [&](const int after[], int, int captured, PieceType promotion) {
+        if (captured >= 0 || promotion != EMPTY) return true;
+        uint16_t value = values[positions.index(after, opposite(sideToMove))];
+        if (!isWin(value)) return false;
+        distance = std::max(distance, value);
+        return true;
+    });
+    return allWin ? distance : 0;
+}
+
+bool Builder::build(const std::string& name) {
+    size_t size = positions.size();
+    if (size > UINT32_MAX) {
+        std::fprintf(stderr, "%s: too many positions\n", name.c_str());
+        return false;
+    }
+    if (!initialise()) return false;
+
+    // Odd plies win by moving into a loss one ply shorter; even ones lose
+    // once every move leads to a win for the opponent
+    std::vector<bool> queued(size, false);
+    std::vector<uint32_t> fresh = scheduled[0];
+    for (int distance = 1; !fresh.empty() || distance < static_cast<int>(scheduled.size()); distance++) {
+        if (distance + 1 >= Tablebases::NO_POSITION) {
+            std::fprintf(stderr, "%s: mates this long do not fit\n", name.c_str());
+            return false;
+        }
+        if (static_cast<size_t>(distance) >= scheduled.size()) scheduled.resize(distance + 1);
+        uint16_t value = static_cast<uint16_t>(distance + 1);
+        std::vector<uint32_t> decided;
+        std::vector<uint32_t> candidates;
+
+        for (uint32_t index : fresh) {
+            int squares[TB_MAX_PIECES];
+            Color sideToMove;
+            positions.position(index, squares, sideToMove);
+            forEachUnmove(squares, sideToMove, [&](const int before[]) {
+                size_t previous = positions.index(before, opposite(sideToMove));
+                if (values[previous] != 0 || queued[previous]) return;
+                if (distance & 1) {
+                    values[previous] = value;
+                    decided.push_back(static_cast<uint32_t>(previous));
+                } else {
+                    queued[previous] = true;
+                    candidates.push_back(static_cast<uint32_t>(previous));
+                }
+            });
+        }
+
+        for (uint32_t index : candidates) {
+            queued[index] = false;
+            uint16_t loss = lossDistance(index);
+            if (loss == distance) {
+                values[index] = value;
+                decided.push_back(index);
+            } else if (loss > distance) {
+                // Waits for the slowest loss its moves out of the table allow
+                if (loss >= scheduled.size()) scheduled.resize(loss + 1);
+                scheduled[loss].push_back(index);
+            }
+        }
+
+        for (uint32_t index : scheduled[distance]) {
+            if (values[index] != 0) continue;
+            values[index] = value;
+            decided.push_back(index);
+        }
+        std::vector<uint32_t>().swap(scheduled[distance]);
+
+        if (!decided.empty()) longest = distance;
+        fresh.swap(decided);
+    }
+    return true;
+}
+
+// Every position of the written table against the best of its moves'
+// results, all read back through Tablebases
+bool verifyTable(const std::string& directory, const std::vector<Piece>& pieces) {
+    Tablebases tables;
+    tables.setPath(directory);
+    TbIndex positions(pieces);
+    int count = static_cast<int>(pieces.size());
+
+    ChessGame game;
+    size_t mismatches = 0;
+    int squares[TB_MAX_PIECES];
+    for (size_t index = 0; index < positions.size(); index++) {
+        Color sideToMove;
+        positions.position(index, squares, sideToMove);
+        Piece board[64];
+        Bitboard used = 0;
+        for (int i = 0; i < count; i++) {
+            used |= squareBB(squares[i]);
+            board[squares[i]] = pieces[i];
+        }
+        if (popCount(used) != count || positions.index(squares, sideToMove) != index) continue;
+        if (!game.setFromFen(fenOf(board, sideToMove)) || game.isInCheck(opposite(sideToMove))) continue;
+
+        TbResult expected{0, 0};
+        MoveList moves;
+        game.generateLegalMoves(moves);
+        if (moves.empty() && game.isInCheck(sideToMove)) expected = TbResult{-1, 0};
+        bool anyWin = false, anyDraw = false, covered = true;
+        int fastestWin = INT_MAX, slowestLoss = 0;
+        for (const Move& move : moves) {
+            game.makeMove(move);
+            Piece after[64];
+            readBoard(game, after);
+            TbResult reply{0, 0};
+            covered = tables.probe(after, opposite(sideToMove), reply) && covered;
+            game.unmakeMove();
+            if (reply.wdl < 0) {
+                anyWin = true;
+                fastestWin = std::min(fastestWin, reply.plies + 1);
+            } else if (reply.wdl == 0) {
+                anyDraw = true;
+            } else {
+                slowestLoss = std::max(slowestLoss, reply.plies + 1);
+            }
+        }
+        if (!moves.empty()) {
+            expected = anyWin ? TbResult{1, fastestWin} : anyDraw ? TbResult{0, 0} : TbResult{-1, slowestLoss};
+        }
+
+        TbResult stored{0, 0};
+        if (!covered || !tables.probe(board, sideToMove, stored) || valueOf(stored) != valueOf(expected)) {
+            if (mismatches++ < 5) {
+                std::fprintf(stderr, "  %s: table %d/%d, moves %d/%d\n", fenOf(board, sideToMove).c_str(),
+                             stored.wdl, stored.plies, expected.wdl, expected.plies);
+            }
+        }
+    }
+    if (mismatches) std::fprintf(stderr, "%zu positions disagree with their moves\n", mismatches);
+    return mismatches == 0;
+}
+
+bool buildTable(const std::string& directory, const std::string& name, const Tablebases& sources, bool verify) {
+    std::vector<Piece> pieces;
+    if (!Tablebases::parseName(name, pieces) || pieces.size() < 3) {
+        std::fprintf(stderr, "%s: not a material of three to %d pieces\n", name.c_str(), TB_MAX_PIECES);
+        return false;
+    }
+
+    // As the file name has it, pieces in index order
+    std::string canonical;
+    for (const Piece& piece : pieces) {
+        if (piece.type == KING && piece.color == BLACK) canonical += 'v';
+        canonical += "?PNBRQK"[piece.type];
+    }
+
+    Builder builder(pieces, sources);
+    if (!builder.build(name)) return false;
+    const std::vector<uint16_t>& values = builder.getValues();
+
+    std::string path = directory + "/" + canonical + ".cmtb";
+    if (!Tablebases::writeTable(path, static_cast<int>(pieces.size()), values)) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return false;
+    }
+
+    size_t wins = 0, losses = 0, positions = 0;
+    for (uint16_t value : values) {
+        if (value == Tablebases::NO_POSITION) continue;
+        positions++;
+        if (isWin(value)) wins++;
+        if (value != 0 && !isWin(value)) losses++;
+    }
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    long bytes = 0;
+    if (file && std::fseek(file, 0, SEEK_END) == 0) bytes = std::ftell(file);
+    if (file) std::fclose(file);
+    std::printf("%-8s %zu positions, %zu won, %zu lost, longest mate %d plies, %ld KB\n", name.c_str(),
+                positions, wins, losses, builder.getLongest(), (bytes + 1023) / 1024);
+
+    if (verify && !verifyTable(directory, pieces)) {
+        std::fprintf(stderr, "%s: verification FAILED\n", name.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int first = 1;
+    bool verify = false;
+    if (argc > 1 && std::strcmp(argv[1], "--verify") == 0) {
+        verify = true;
+        first++;
+    }
+    if (argc - first < 2) {
+        std::printf("usage: maketb [--verify] DIRECTORY NAME...\n");
+        return 2;
+    }
+
+    ensureTablesInit();
+    std::string directory = argv[first];
+    Tablebases sources;
+    sources.setUnpacked(true);
+    for (int i = first + 1; i < argc; i++) {
+        // Rescanned so each table sees the ones built before it
+        sources.setPath(directory);
+        if (!buildTable(directory, argv[i], sources, verify)) return 1;
+    }
+    if (verify) std::printf("tablebase check passed\n");
+    return 0;
+}
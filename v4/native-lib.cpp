@@ -1,1076 +1,346 @@
 #include <jni.h>
-#include <string>
-#include <vector>
 #include <algorithm>
-#include <ctime>
-#include <random>
-#include <limits>
-#include <cstdlib>
-#include <android/log.h>
-
-#define LOG_TAG "ChessNative"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-
-// Thread-safe random number generation
-class RandomGenerator {
-private:
-    std::mt19937 rng;
-
-public:
-    RandomGenerator() : rng(static_cast<unsigned int>(time(nullptr))) {}
-
-    int getSmallNoise() {
-        std::uniform_int_distribution<int> dist(0, 5);
-        return dist(rng);
-    }
-
-    int getCoinFlip() {
-        std::uniform_int_distribution<int> dist(0, 1);
-        return dist(rng);
-    }
-};
+#include <memory>
+#include <mutex>
+
+#include "engine/bench.h"
+#include "engine/book.h"
+#include "engine/chess_game.h"
+#include "engine/cpu_affinity.h"
+#include "engine/engine.h"
+#include "engine/game_pool.h"
+#include "engine/log.h"
+#include "engine/nnue.h"
+#include "engine/tablebase.h"
+#include "engine/tt.h"
+
+// MainActivity's game, used from the UI thread only
+GameInstance* mainGame = nullptr;
+int aiDifficulty = 2;
+int hashSizeMB = TranspositionTable::DEFAULT_SIZE_MB;
+
+// Search threads for the main game; zero picks one per fast core
+int searchThreads = 0;
+
+// Added to the main game's version so that one created after cleanupGame
+// never repeats a version the UI has already seen
+jint versionBase = 0;
+
+// Games created through NativeEngine, each with a 1 MB table and one
+// search thread. An instance, table included, takes about 1.1 MB while it
+// is in the pool; from its first search until it is released its thread
+// adds its stack, a copy of the board and a pawn cache of 0.35 MB.
+const int POOLED_HASH_MB = 1;
+const int POOLED_THREADS = 1;
+GamePool* gamePool = nullptr;
+std::once_flag gamePoolCreated;
+
+// What every game, the main one and the pooled ones alike, plays with.
+// Games pick up a new set when they next start a search and hold on to
+// the one they have until then, so replacing it never waits on a game.
+SharedResources sharedResources;
+
+// Guards the data below while it is replaced and the set is rebuilt
+std::mutex resourceMutex;
+
+// Evaluation network, if one was loaded, and whether games use it
+std::shared_ptr<const NnueNetwork> network;
+bool useNetwork = true;
+
+// Opening book, if one was loaded
+std::shared_ptr<const OpeningBook> book;
+
+// Endgame tables, if a directory holding some was set
+std::shared_ptr<const Tablebases> tablebases;
+
+// Bumped whenever the main game's position changes, so the UI can tell
+// whether what it last read is still current
+jint positionVersion() {
+    return versionBase + (mainGame ? static_cast<jint>(mainGame->getVersion()) : 0);
+}
 
-static RandomGenerator* g_random = nullptr;
+GamePool* pool() {
+    std::call_once(gamePoolCreated, []() {
+        gamePool = new GamePool(POOLED_HASH_MB, POOLED_THREADS, &sharedResources);
+    });
+    return gamePool;
+}
 
-void ensureRandomInit() {
-    if (!g_random) {
-        g_random = new RandomGenerator();
-    }
+// Offers games the current data: the network when loaded and enabled, the
+// piece-square tables otherwise. Called with resourceMutex held.
+void publishResources() {
+    std::shared_ptr<GameResources> resources = std::make_shared<GameResources>();
+    if (useNetwork) resources->network = network;
+    resources->book = book;
+    resources->tablebases = tablebases;
+    sharedResources.publish(std::move(resources));
 }
 
-enum PieceType {
-    EMPTY = 0,
-    PAWN = 1,
-    KNIGHT = 2,
-    BISHOP = 3,
-    ROOK = 4,
-    QUEEN = 5,
-    KING = 6
-};
-
-enum Color {
-    NONE = 0,
-    WHITE = 1,
-    BLACK = 2
-};
-
-struct Piece {
-    PieceType type;
-    Color color;
-    bool hasMoved;
-
-    Piece() : type(EMPTY), color(NONE), hasMoved(false) {}
-    Piece(PieceType t, Color c, bool m) : type(t), color(c), hasMoved(m) {}
-};
-
-struct Move {
-    int fromRow, fromCol, toRow, toCol;
-    bool isCapture;
-    bool isCastling;
-    bool isEnPassant;
-    bool isPromotion;
-    int score;
-    Piece capturedPiece;
-
-    Move() : fromRow(-1), fromCol(-1), toRow(-1), toCol(-1),
-             isCapture(false), isCastling(false), isEnPassant(false),
-             isPromotion(false), score(0) {}
-};
-
-class ChessGame {
-private:
-    Piece board[8][8];
-    Color currentPlayer;
-    bool whiteKingMoved, blackKingMoved;
-    bool whiteRookAMoved, whiteRookHMoved;
-    bool blackRookAMoved, blackRookHMoved;
-    int enPassantCol;
-    int enPassantRow;
-    std::vector<Move> moveHistory;
-    int halfMoveClock;
-    int fullMoveNumber;
-    bool initialized;
-
-    // Piece-square tables
-    static const int pawnTableWhite[8][8];
-    static const int knightTable[8][8];
-    static const int bishopTable[8][8];
-    static const int rookTable[8][8];
-    static const int queenTable[8][8];
-    static const int kingTableMiddle[8][8];
-    static const int kingTableEnd[8][8];
-
-public:
-    ChessGame() : initialized(false) {
-        LOGD("ChessGame constructor called");
-        ensureRandomInit();
-        initializeBoard();
-    }
+// {fromRow, fromCol, toRow, toCol}, all -1 for no move
+jintArray moveToArray(JNIEnv* env, const Move& move) {
+    jintArray result = env->NewIntArray(4);
+    jint moveData[4] = {-1, -1, -1, -1};
+    if (!move.isNull()) {
+        moveData[0] = rowOf(move.from());
+        moveData[1] = colOf(move.from());
+        moveData[2] = rowOf(move.to());
+        moveData[3] = colOf(move.to());
+    }
+    env->SetIntArrayRegion(result, 0, 4, moveData);
+    return result;
+}
 
-    ~ChessGame() {
-        LOGD("ChessGame destructor called");
-    }
+// Fills board with every square's getPiece code; false when it is too short
+bool copyBoard(JNIEnv* env, GameInstance* instance, jintArray board) {
+    if (!board || env->GetArrayLength(board) < 64) return false;
+    int codes[64] = {0};
+    if (instance) instance->getGame().getBoard(codes);
+    jint values[64];
+    std::copy(codes, codes + 64, values);
+    env->SetIntArrayRegion(board, 0, 64, values);
+    return true;
+}
 
-    void initializeBoard() {
-        try {
-            LOGD("Initializing board...");
-
-            // Clear board
-            for (int i = 0; i < 8; i++) {
-                for (int j = 0; j < 8; j++) {
-                    board[i][j] = Piece(EMPTY, NONE, false);
-                }
-            }
-
-            // Setup black pieces
-            board[0][0] = Piece(ROOK, BLACK, false);
-            board[0][1] = Piece(KNIGHT, BLACK, false);
-            board[0][2] = Piece(BISHOP, BLACK, false);
-            board[0][3] = Piece(QUEEN, BLACK, false);
-            board[0][4] = Piece(KING, BLACK, false);
-            board[0][5] = Piece(BISHOP, BLACK, false);
-            board[0][6] = Piece(KNIGHT, BLACK, false);
-            board[0][7] = Piece(ROOK, BLACK, false);
-
-            for (int i = 0; i < 8; i++) {
-                board[1][i] = Piece(PAWN, BLACK, false);
-            }
-
-            // Setup white pieces
-            board[7][0] = Piece(ROOK, WHITE, false);
-            board[7][1] = Piece(KNIGHT, WHITE, false);
-            board[7][2] = Piece(BISHOP, WHITE, false);
-            board[7][3] = Piece(QUEEN, WHITE, false);
-            board[7][4] = Piece(KING, WHITE, false);
-            board[7][5] = Piece(BISHOP, WHITE, false);
-            board[7][6] = Piece(KNIGHT, WHITE, false);
-            board[7][7] = Piece(ROOK, WHITE, false);
-
-            for (int i = 0; i < 8; i++) {
-                board[6][i] = Piece(PAWN, WHITE, false);
-            }
-
-            currentPlayer = WHITE;
-            whiteKingMoved = blackKingMoved = false;
-            whiteRookAMoved = whiteRookHMoved = false;
-            blackRookAMoved = blackRookHMoved = false;
-            enPassantCol = -1;
-            enPassantRow = -1;
-            halfMoveClock = 0;
-            fullMoveNumber = 1;
-            moveHistory.clear();
-            initialized = true;
-
-            LOGD("Board initialized successfully");
-        } catch (const std::exception& e) {
-            LOGE("Exception in initializeBoard: %s", e.what());
-            initialized = false;
-        } catch (...) {
-            LOGE("Unknown exception in initializeBoard");
-            initialized = false;
-        }
+// Targets of the legal moves from (row, col) as row, col pairs
+jintArray legalMovesFrom(JNIEnv* env, GameInstance& instance, jint row, jint col) {
+    int from = squareOf(row, col);
+    jint positions[2 * MAX_MOVES];
+    int count = 0;
+    for (const Move& move : instance.legalMoves()) {
+        if (move.from() != from) continue;
+        // The four promotion choices share a target square; report it once
+        if (move.isPromotion() && move.promotionType() != QUEEN) continue;
+        positions[count++] = rowOf(move.to());
+        positions[count++] = colOf(move.to());
+    }
+
+    jintArray result = env->NewIntArray(count);
+    if (result == nullptr) {
+        LOGE("Failed to create int array");
+        return env->NewIntArray(0);
     }
-
-    bool isInitialized() const {
-        return initialized;
+    if (count > 0) {
+        env->SetIntArrayRegion(result, 0, count, positions);
     }
+    return result;
+}
 
-    int getPiece(int row, int col) {
-        if (row < 0 || row >= 8 || col < 0 || col >= 8) {
-            LOGE("Invalid board access: %d, %d", row, col);
-            return 0;
-        }
-
-        try {
-            Piece p = board[row][col];
-            if (p.type == EMPTY) return 0;
-            return (p.color * 10) + p.type;
-        } catch (...) {
-            LOGE("Exception in getPiece");
-            return 0;
+// Every legal move as from * 64 + to; promotions appear once, as the queen's
+jintArray allLegalMoves(JNIEnv* env, GameInstance* instance) {
+    jint packed[MAX_MOVES];
+    int count = 0;
+    if (instance) {
+        for (const Move& move : instance->legalMoves()) {
+            if (move.isPromotion() && move.promotionType() != QUEEN) continue;
+            packed[count++] = move.from() * 64 + move.to();
         }
     }
 
-    bool isValidPosition(int row, int col) {
-        return row >= 0 && row < 8 && col >= 0 && col < 8;
+    jintArray result = env->NewIntArray(count);
+    if (result == nullptr) {
+        LOGE("Failed to create int array");
+        return nullptr;
     }
-
-    std::vector<Move> getLegalMoves(int row, int col) {
-        std::vector<Move> moves;
-        try {
-            if (!initialized || !isValidPosition(row, col)) return moves;
-
-            Piece piece = board[row][col];
-            if (piece.type == EMPTY || piece.color != currentPlayer) return moves;
-
-            std::vector<Move> pseudoMoves = getPseudoLegalMoves(row, col);
-
-            for (const Move& move : pseudoMoves) {
-                if (isLegalMove(move)) {
-                    moves.push_back(move);
-                }
-            }
-        } catch (const std::exception& e) {
-            LOGE("Exception in getLegalMoves: %s", e.what());
-        } catch (...) {
-            LOGE("Unknown exception in getLegalMoves");
-        }
-
-        return moves;
+    if (count > 0) {
+        env->SetIntArrayRegion(result, 0, count, packed);
     }
+    return result;
+}
 
-    std::vector<Move> getPseudoLegalMoves(int row, int col) {
-        std::vector<Move> moves;
-        Piece piece = board[row][col];
-
-        switch (piece.type) {
-            case PAWN:
-                getPawnMoves(row, col, moves);
-                break;
-            case KNIGHT:
-                getKnightMoves(row, col, moves);
-                break;
-            case BISHOP:
-                getBishopMoves(row, col, moves);
-                break;
-            case ROOK:
-                getRookMoves(row, col, moves);
-                break;
-            case QUEEN:
-                getQueenMoves(row, col, moves);
-                break;
-            case KING:
-                getKingMoves(row, col, moves);
-                break;
-            default:
-                break;
-        }
-
-        return moves;
-    }
+// The latest search iteration as a UCI-style line, null before the first
+jstring searchInfo(JNIEnv* env, GameInstance* instance) {
+    SearchInfo info;
+    if (!instance || !instance->getEngine().getSearchInfo(info)) return nullptr;
+    return env->NewStringUTF(info.toString().c_str());
+}
 
-    void getPawnMoves(int row, int col, std::vector<Move>& moves) {
-        Piece piece = board[row][col];
-        int direction = (piece.color == WHITE) ? -1 : 1;
-        int startRow = (piece.color == WHITE) ? 6 : 1;
-
-        // Forward move
-        if (isValidPosition(row + direction, col) && board[row + direction][col].type == EMPTY) {
-            bool isPromotion = (row + direction == 0 || row + direction == 7);
-            Move move;
-            move.fromRow = row;
-            move.fromCol = col;
-            move.toRow = row + direction;
-            move.toCol = col;
-            move.isPromotion = isPromotion;
-            moves.push_back(move);
-
-            // Double forward
-            if (row == startRow && board[row + 2 * direction][col].type == EMPTY) {
-                Move doubleMove;
-                doubleMove.fromRow = row;
-                doubleMove.fromCol = col;
-                doubleMove.toRow = row + 2 * direction;
-                doubleMove.toCol = col;
-                moves.push_back(doubleMove);
-            }
-        }
+// The finished search's move, or null while it is still running
+jintArray polledMove(JNIEnv* env, GameInstance& instance) {
+    Move move;
+    if (!instance.pollMove(move)) return nullptr;
+    return moveToArray(env, move);
+}
 
-        // Captures
-        for (int dcol : {-1, 1}) {
-            int newRow = row + direction;
-            int newCol = col + dcol;
-            if (isValidPosition(newRow, newCol)) {
-                Piece target = board[newRow][newCol];
-                if (target.type != EMPTY && target.color != piece.color) {
-                    bool isPromotion = (newRow == 0 || newRow == 7);
-                    Move move;
-                    move.fromRow = row;
-                    move.fromCol = col;
-                    move.toRow = newRow;
-                    move.toCol = newCol;
-                    move.isCapture = true;
-                    move.isPromotion = isPromotion;
-                    move.capturedPiece = target;
-                    moves.push_back(move);
-                }
-                // En passant
-                if (newCol == enPassantCol && newRow == enPassantRow) {
-                    Move move;
-                    move.fromRow = row;
-                    move.fromCol = col;
-                    move.toRow = newRow;
-                    move.toCol = newCol;
-                    move.isCapture = true;
-                    move.isEnPassant = true;
-                    move.capturedPiece = Piece(PAWN, (piece.color == WHITE ? BLACK : WHITE), true);
-                    moves.push_back(move);
-                }
-            }
-        }
-    }
+// JNI Functions
+extern "C" JNIEXPORT void JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_initGame(JNIEnv* env, jobject thiz) {
+    try {
+        LOGD("initGame called");
 
-    void getKnightMoves(int row, int col, std::vector<Move>& moves) {
-        Piece piece = board[row][col];
-        int offsets[8][2] = {{-2,-1},{-2,1},{-1,-2},{-1,2},{1,-2},{1,2},{2,-1},{2,1}};
-
-        for (auto& offset : offsets) {
-            int newRow = row + offset[0];
-            int newCol = col + offset[1];
-            if (isValidPosition(newRow, newCol)) {
-                Piece target = board[newRow][newCol];
-                if (target.type == EMPTY || target.color != piece.color) {
-                    Move move;
-                    move.fromRow = row;
-                    move.fromCol = col;
-                    move.toRow = newRow;
-                    move.toCol = newCol;
-                    move.isCapture = (target.type != EMPTY);
-                    move.capturedPiece = target;
-                    moves.push_back(move);
-                }
-            }
+        if (mainGame) {
+            // Cancels the old game's search and keeps its table
+            mainGame->newGame();
+        } else {
+            LOGD("Creating new game");
+            mainGame = new GameInstance(hashSizeMB, searchThreads, &sharedResources);
         }
+        mainGame->setDifficulty(aiDifficulty);
+        LOGD("Game initialized successfully");
+    } catch (const std::exception& e) {
+        LOGE("Exception in initGame: %s", e.what());
+    } catch (...) {
+        LOGE("Unknown exception in initGame");
     }
+}
 
-    void getBishopMoves(int row, int col, std::vector<Move>& moves) {
-        int directions[4][2] = {{-1,-1},{-1,1},{1,-1},{1,1}};
-        getSlidingMoves(row, col, directions, 4, moves);
-    }
-
-    void getRookMoves(int row, int col, std::vector<Move>& moves) {
-        int directions[4][2] = {{-1,0},{1,0},{0,-1},{0,1}};
-        getSlidingMoves(row, col, directions, 4, moves);
-    }
-
-    void getQueenMoves(int row, int col, std::vector<Move>& moves) {
-        int directions[8][2] = {{-1,-1},{-1,0},{-1,1},{0,-1},{0,1},{1,-1},{1,0},{1,1}};
-        getSlidingMoves(row, col, directions, 8, moves);
+extern "C" JNIEXPORT void JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_setDifficulty(JNIEnv* env, jobject, jint difficulty) {
+    try {
+        aiDifficulty = difficulty;
+        if (mainGame) mainGame->setDifficulty(difficulty);
+        LOGD("Difficulty set to %d", difficulty);
+    } catch (...) {
+        LOGE("Exception in setDifficulty");
     }
+}
 
-    void getSlidingMoves(int row, int col, int directions[][2], int numDirs, std::vector<Move>& moves) {
-        Piece piece = board[row][col];
-        for (int d = 0; d < numDirs; d++) {
-            for (int dist = 1; dist < 8; dist++) {
-                int newRow = row + directions[d][0] * dist;
-                int newCol = col + directions[d][1] * dist;
-                if (!isValidPosition(newRow, newCol)) break;
-
-                Piece target = board[newRow][newCol];
-                Move move;
-                move.fromRow = row;
-                move.fromCol = col;
-                move.toRow = newRow;
-                move.toCol = newCol;
-
-                if (target.type == EMPTY) {
-                    moves.push_back(move);
-                } else {
-                    if (target.color != piece.color) {
-                        move.isCapture = true;
-                        move.capturedPiece = target;
-                        moves.push_back(move);
-                    }
-                    break;
-                }
-            }
+extern "C" JNIEXPORT void JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_setHashSize(JNIEnv* env, jobject, jint megabytes) {
+    try {
+        hashSizeMB = std::max(1, std::min(static_cast<int>(megabytes), TranspositionTable::MAX_SIZE_MB));
+        if (mainGame) {
+            mainGame->cancelSearch();
+            mainGame->getTable().resize(hashSizeMB);
         }
+        LOGD("Hash size set to %d MB", hashSizeMB);
+    } catch (const std::exception& e) {
+        LOGE("Exception in setHashSize: %s", e.what());
+    } catch (...) {
+        LOGE("Unknown exception in setHashSize");
     }
+}
 
-    void getKingMoves(int row, int col, std::vector<Move>& moves) {
-        Piece piece = board[row][col];
-        int directions[8][2] = {{-1,-1},{-1,0},{-1,1},{0,-1},{0,1},{1,-1},{1,0},{1,1}};
-
-        for (auto& dir : directions) {
-            int newRow = row + dir[0];
-            int newCol = col + dir[1];
-            if (isValidPosition(newRow, newCol)) {
-                Piece target = board[newRow][newCol];
-                if (target.type == EMPTY || target.color != piece.color) {
-                    Move move;
-                    move.fromRow = row;
-                    move.fromCol = col;
-                    move.toRow = newRow;
-                    move.toCol = newCol;
-                    move.isCapture = (target.type != EMPTY);
-                    move.capturedPiece = target;
-                    moves.push_back(move);
-                }
-            }
-        }
-
-        // Castling
-        if (!isInCheck(piece.color)) {
-            if (piece.color == WHITE && !whiteKingMoved) {
-                // Kingside castling
-                if (!whiteRookHMoved && board[7][5].type == EMPTY && board[7][6].type == EMPTY &&
-                    !isSquareAttacked(7, 5, BLACK) && !isSquareAttacked(7, 6, BLACK)) {
-                    Move move;
-                    move.fromRow = 7;
-                    move.fromCol = 4;
-                    move.toRow = 7;
-                    move.toCol = 6;
-                    move.isCastling = true;
-                    moves.push_back(move);
-                }
-                // Queenside castling
-                if (!whiteRookAMoved && board[7][1].type == EMPTY && board[7][2].type == EMPTY &&
-                    board[7][3].type == EMPTY && !isSquareAttacked(7, 3, BLACK) &&
-                    !isSquareAttacked(7, 2, BLACK)) {
-                    Move move;
-                    move.fromRow = 7;
-                    move.fromCol = 4;
-                    move.toRow = 7;
-                    move.toCol = 2;
-                    move.isCastling = true;
-                    moves.push_back(move);
-                }
-            } else if (piece.color == BLACK && !blackKingMoved) {
-                // Kingside castling
-                if (!blackRookHMoved && board[0][5].type == EMPTY && board[0][6].type == EMPTY &&
-                    !isSquareAttacked(0, 5, WHITE) && !isSquareAttacked(0, 6, WHITE)) {
-                    Move move;
-                    move.fromRow = 0;
-                    move.fromCol = 4;
-                    move.toRow = 0;
-                    move.toCol = 6;
-                    move.isCastling = true;
-                    moves.push_back(move);
-                }
-                // Queenside castling
-                if (!blackRookAMoved && board[0][1].type == EMPTY && board[0][2].type == EMPTY &&
-                    board[0][3].type == EMPTY && !isSquareAttacked(0, 3, WHITE) &&
-                    !isSquareAttacked(0, 2, WHITE)) {
-                    Move move;
-                    move.fromRow = 0;
-                    move.fromCol = 4;
-                    move.toRow = 0;
-                    move.toCol = 2;
-                    move.isCastling = true;
-                    moves.push_back(move);
-                }
-            }
-        }
+// Search threads; zero or less picks one per fast core
+extern "C" JNIEXPORT void JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_setThreads(JNIEnv* env, jobject, jint threads) {
+    try {
+        searchThreads = threads > 0 ? threads : recommendedThreadCount();
+        if (mainGame) mainGame->getEngine().setThreadCount(searchThreads);
+    } catch (const std::exception& e) {
+        LOGE("Exception in setThreads: %s", e.what());
+    } catch (...) {
+        LOGE("Unknown exception in setThreads");
     }
+}
 
-    bool isSquareAttacked(int row, int col, Color attackerColor) {
-        for (int r = 0; r < 8; r++) {
-            for (int c = 0; c < 8; c++) {
-                Piece piece = board[r][c];
-                if (piece.type != EMPTY && piece.color == attackerColor) {
-                    if (piece.type == PAWN) {
-                        int direction = (attackerColor == WHITE) ? -1 : 1;
-                        for (int dc : {-1, 1}) {
-                            if (r + direction == row && c + dc == col) return true;
-                        }
-                    } else {
-                        std::vector<Move> moves = getPseudoLegalMoves(r, c);
-                        for (const Move& move : moves) {
-                            if (move.toRow == row && move.toCol == col && !move.isCastling) {
-                                return true;
-                            }
-                        }
-                    }
-                }
-            }
-        }
+// Maps an NNUE network file; on failure the previous evaluator stays
+extern "C" JNIEXPORT jboolean JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_loadNetwork(JNIEnv* env, jobject, jstring path) {
+    try {
+        const char* chars = env->GetStringUTFChars(path, nullptr);
+        if (!chars) return false;
+        std::string filePath(chars);
+        env->ReleaseStringUTFChars(path, chars);
+
+        std::shared_ptr<NnueNetwork> loaded = std::make_shared<NnueNetwork>();
+        if (!loaded->load(filePath)) return false;
+
+        // Searches still running keep the old network until they end
+        std::lock_guard<std::mutex> lock(resourceMutex);
+        network = std::move(loaded);
+        publishResources();
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("Exception in loadNetwork: %s", e.what());
         return false;
-    }
-
-    bool isInCheck(Color color) {
-        int kingRow = -1, kingCol = -1;
-        for (int r = 0; r < 8; r++) {
-            for (int c = 0; c < 8; c++) {
-                if (board[r][c].type == KING && board[r][c].color == color) {
-                    kingRow = r;
-                    kingCol = c;
-                    break;
-                }
-            }
-            if (kingRow != -1) break;
-        }
-
-        if (kingRow == -1) return false;
-        return isSquareAttacked(kingRow, kingCol, (color == WHITE) ? BLACK : WHITE);
-    }
-
-    bool isLegalMove(const Move& move) {
-        // Save state
-        Piece tempPiece = board[move.toRow][move.toCol];
-        Piece movingPiece = board[move.fromRow][move.fromCol];
-        int tempEnPassantCol = enPassantCol;
-        int tempEnPassantRow = enPassantRow;
-        Color savedPlayer = currentPlayer;
-
-        // Make move
-        board[move.toRow][move.toCol] = movingPiece;
-        board[move.fromRow][move.fromCol] = Piece(EMPTY, NONE, false);
-
-        Piece capturedPawn;
-        if (move.isEnPassant) {
-            int captureRow = (movingPiece.color == WHITE) ? move.toRow + 1 : move.toRow - 1;
-            capturedPawn = board[captureRow][move.toCol];
-            board[captureRow][move.toCol] = Piece(EMPTY, NONE, false);
-        }
-
-        Piece savedRook;
-        int rookFromCol = -1, rookToCol = -1;
-        if (move.isCastling) {
-            int row = move.fromRow;
-            if (move.toCol == 6) {
-                rookFromCol = 7;
-                rookToCol = 5;
-            } else {
-                rookFromCol = 0;
-                rookToCol = 3;
-            }
-            savedRook = board[row][rookToCol];
-            board[row][rookToCol] = board[row][rookFromCol];
-            board[row][rookFromCol] = Piece(EMPTY, NONE, false);
-        }
-
-        bool legal = !isInCheck(savedPlayer);
-
-        // Restore state
-        board[move.fromRow][move.fromCol] = movingPiece;
-        board[move.toRow][move.toCol] = tempPiece;
-        enPassantCol = tempEnPassantCol;
-        enPassantRow = tempEnPassantRow;
-        currentPlayer = savedPlayer;
-
-        if (move.isEnPassant) {
-            int captureRow = (movingPiece.color == WHITE) ? move.toRow + 1 : move.toRow - 1;
-            board[captureRow][move.toCol] = capturedPawn;
-        }
-
-        if (move.isCastling) {
-            int row = move.fromRow;
-            board[row][rookFromCol] = board[row][rookToCol];
-            board[row][rookToCol] = savedRook;
-        }
-
-        return legal;
-    }
-
-    bool makeMove(int fromRow, int fromCol, int toRow, int toCol, int promotionPiece = QUEEN) {
-        try {
-            if (!initialized) {
-                LOGE("Game not initialized");
-                return false;
-            }
-
-            std::vector<Move> legalMoves = getLegalMoves(fromRow, fromCol);
-
-            for (const Move& move : legalMoves) {
-                if (move.toRow == toRow && move.toCol == toCol) {
-                    executeMoveInternal(move, promotionPiece);
-                    return true;
-                }
-            }
-        } catch (const std::exception& e) {
-            LOGE("Exception in makeMove: %s", e.what());
-        } catch (...) {
-            LOGE("Unknown exception in makeMove");
-        }
+    } catch (...) {
+        LOGE("Unknown exception in loadNetwork");
         return false;
     }
+}
 
-    void executeMoveInternal(const Move& move, int promotionPiece) {
-        Piece piece = board[move.fromRow][move.fromCol];
-
-        // Handle en passant capture
-        if (move.isEnPassant) {
-            int captureRow = (piece.color == WHITE) ? move.toRow + 1 : move.toRow - 1;
-            board[captureRow][move.toCol] = Piece(EMPTY, NONE, false);
-        }
-
-        // Handle castling
-        if (move.isCastling) {
-            if (move.toCol == 6) {
-                board[move.fromRow][5] = board[move.fromRow][7];
-                board[move.fromRow][7] = Piece(EMPTY, NONE, false);
-                board[move.fromRow][5].hasMoved = true;
-            } else {
-                board[move.fromRow][3] = board[move.fromRow][0];
-                board[move.fromRow][0] = Piece(EMPTY, NONE, false);
-                board[move.fromRow][3].hasMoved = true;
-            }
-        }
-
-        // Update en passant
-        enPassantCol = -1;
-        enPassantRow = -1;
-        if (piece.type == PAWN && abs(move.fromRow - move.toRow) == 2) {
-            enPassantCol = move.fromCol;
-            enPassantRow = (move.fromRow + move.toRow) / 2;
-        }
-
-        // Update half-move clock
-        if (piece.type == PAWN || move.isCapture) {
-            halfMoveClock = 0;
-        } else {
-            halfMoveClock++;
-        }
-
-        // Move piece
-        board[move.toRow][move.toCol] = piece;
-        board[move.fromRow][move.fromCol] = Piece(EMPTY, NONE, false);
-        board[move.toRow][move.toCol].hasMoved = true;
-
-        // Handle promotion
-        if (move.isPromotion) {
-            board[move.toRow][move.toCol].type = static_cast<PieceType>(promotionPiece);
-        }
-
-        // Update castling rights
-        if (piece.type == KING) {
-            if (piece.color == WHITE) whiteKingMoved = true;
-            else blackKingMoved = true;
-        }
-        if (piece.type == ROOK) {
-            if (piece.color == WHITE) {
-                if (move.fromCol == 0) whiteRookAMoved = true;
-                if (move.fromCol == 7) whiteRookHMoved = true;
-            } else {
-                if (move.fromCol == 0) blackRookAMoved = true;
-                if (move.fromCol == 7) blackRookHMoved = true;
-            }
-        }
-
-        // Update move counter
-        if (currentPlayer == BLACK) fullMoveNumber++;
-
-        // Switch player
-        currentPlayer = (currentPlayer == WHITE) ? BLACK : WHITE;
-
-        // Add to history
-        moveHistory.push_back(move);
-    }
-
-    int evaluateBoard() {
-        int score = 0;
-        int pieceValues[7] = {0, 100, 320, 330, 500, 900, 20000};
-
-        int materialCount = 0;
-        for (int r = 0; r < 8; r++) {
-            for (int c = 0; c < 8; c++) {
-                if (board[r][c].type != EMPTY && board[r][c].type != KING) {
-                    materialCount++;
-                }
-            }
-        }
-        bool isEndgame = materialCount < 12;
-
-        for (int r = 0; r < 8; r++) {
-            for (int c = 0; c < 8; c++) {
-                Piece piece = board[r][c];
-                if (piece.type != EMPTY) {
-                    int value = pieceValues[piece.type];
-                    int posValue = 0;
-
-                    if (piece.type == PAWN) {
-                        posValue = (piece.color == WHITE) ? pawnTableWhite[r][c] : pawnTableWhite[7-r][c];
-                    } else if (piece.type == KNIGHT) {
-                        posValue = (piece.color == WHITE) ? knightTable[r][c] : knightTable[7-r][c];
-                    } else if (piece.type == BISHOP) {
-                        posValue = (piece.color == WHITE) ? bishopTable[r][c] : bishopTable[7-r][c];
-                    } else if (piece.type == ROOK) {
-                        posValue = (piece.color == WHITE) ? rookTable[r][c] : rookTable[7-r][c];
-                    } else if (piece.type == QUEEN) {
-                        posValue = (piece.color == WHITE) ? queenTable[r][c] : queenTable[7-r][c];
-                    } else if (piece.type == KING) {
-                        if (isEndgame) {
-                            posValue = (piece.color == WHITE) ? kingTableEnd[r][c] : kingTableEnd[7-r][c];
-                        } else {
-                            posValue = (piece.color == WHITE) ? kingTableMiddle[r][c] : kingTableMiddle[7-r][c];
-                        }
-                    }
-
-                    value += posValue;
-
-                    if (piece.color == WHITE) score += value;
-                    else score -= value;
-                }
-            }
-        }
-
-        return score;
-    }
-
-    int scoreMoveOrdering(const Move& move) {
-        int score = 0;
-
-        if (move.capturedPiece.type != EMPTY) {
-            int pieceValues[7] = {0, 100, 320, 330, 500, 900, 20000};
-            Piece attacker = board[move.fromRow][move.fromCol];
-            score = 10 * pieceValues[move.capturedPiece.type] - pieceValues[attacker.type];
-        }
-
-        if (move.isPromotion) score += 800;
-
-        if (move.toRow >= 3 && move.toRow <= 4 && move.toCol >= 3 && move.toCol <= 4) {
-            score += 20;
-        }
-
-        return score;
-    }
-
-    int minimax(int depth, int alpha, int beta, bool maximizing) {
-        if (depth == 0) return evaluateBoard();
-
-        std::vector<Move> allMoves;
-        for (int r = 0; r < 8; r++) {
-            for (int c = 0; c < 8; c++) {
-                if (board[r][c].color == currentPlayer) {
-                    std::vector<Move> moves = getLegalMoves(r, c);
-                    allMoves.insert(allMoves.end(), moves.begin(), moves.end());
-                }
-            }
-        }
-
-        if (allMoves.empty()) {
-            if (isInCheck(currentPlayer)) return maximizing ? -999999 : 999999;
-            return 0;
-        }
-
-        for (Move& move : allMoves) {
-            move.score = scoreMoveOrdering(move);
-        }
-
-        std::sort(allMoves.begin(), allMoves.end(), [](const Move& a, const Move& b) {
-            return a.score > b.score;
-        });
-
-        if (maximizing) {
-            int maxEval = std::numeric_limits<int>::min();
-            for (const Move& move : allMoves) {
-                Piece temp = board[move.toRow][move.toCol];
-                Piece tempEnPassant;
-                int savedEnPassantCol = enPassantCol;
-                int savedEnPassantRow = enPassantRow;
-                Color prevPlayer = currentPlayer;
-                bool savedWhiteKing = whiteKingMoved, savedBlackKing = blackKingMoved;
-                bool savedWRA = whiteRookAMoved, savedWRH = whiteRookHMoved;
-                bool savedBRA = blackRookAMoved, savedBRH = blackRookHMoved;
-
-                if (move.isEnPassant) {
-                    int captureRow = (prevPlayer == WHITE) ? move.toRow + 1 : move.toRow - 1;
-                    tempEnPassant = board[captureRow][move.toCol];
-                }
-
-                executeMoveInternal(move, QUEEN);
-                int eval = minimax(depth - 1, alpha, beta, false);
-
-                currentPlayer = prevPlayer;
-                board[move.fromRow][move.fromCol] = board[move.toRow][move.toCol];
-                board[move.toRow][move.toCol] = temp;
-                enPassantCol = savedEnPassantCol;
-                enPassantRow = savedEnPassantRow;
-                whiteKingMoved = savedWhiteKing;
-                blackKingMoved = savedBlackKing;
-                whiteRookAMoved = savedWRA;
-                whiteRookHMoved = savedWRH;
-                blackRookAMoved = savedBRA;
-                blackRookHMoved = savedBRH;
-
-                if (move.isEnPassant) {
-                    int captureRow = (prevPlayer == WHITE) ? move.toRow + 1 : move.toRow - 1;
-                    board[captureRow][move.toCol] = tempEnPassant;
-                }
-
-                maxEval = std::max(maxEval, eval);
-                alpha = std::max(alpha, eval);
-                if (beta <= alpha) break;
-            }
-            return maxEval;
-        } else {
-            int minEval = std::numeric_limits<int>::max();
-            for (const Move& move : allMoves) {
-                Piece temp = board[move.toRow][move.toCol];
-                Piece tempEnPassant;
-                int savedEnPassantCol = enPassantCol;
-                int savedEnPassantRow = enPassantRow;
-                Color prevPlayer = currentPlayer;
-                bool savedWhiteKing = whiteKingMoved, savedBlackKing = blackKingMoved;
-                bool savedWRA = whiteRookAMoved, savedWRH = whiteRookHMoved;
-                bool savedBRA = blackRookAMoved, savedBRH = blackRookHMoved;
-
-                if (move.isEnPassant) {
-                    int captureRow = (prevPlayer == WHITE) ? move.toRow + 1 : move.toRow - 1;
-                    tempEnPassant = board[captureRow][move.toCol];
-                }
-
-                executeMoveInternal(move, QUEEN);
-                int eval = minimax(depth - 1, alpha, beta, true);
-
-                currentPlayer = prevPlayer;
-                board[move.fromRow][move.fromCol] = board[move.toRow][move.toCol];
-                board[move.toRow][move.toCol] = temp;
-                enPassantCol = savedEnPassantCol;
-                enPassantRow = savedEnPassantRow;
-                whiteKingMoved = savedWhiteKing;
-                blackKingMoved = savedBlackKing;
-                whiteRookAMoved = savedWRA;
-                whiteRookHMoved = savedWRH;
-                blackRookAMoved = savedBRA;
-                blackRookHMoved = savedBRH;
-
-                if (move.isEnPassant) {
-                    int captureRow = (prevPlayer == WHITE) ? move.toRow + 1 : move.toRow - 1;
-                    board[captureRow][move.toCol] = tempEnPassant;
-                }
-
-                minEval = std::min(minEval, eval);
-                beta = std::min(beta, eval);
-                if (beta <= alpha) break;
-            }
-            return minEval;
-        }
-    }
-
-    Move getBestMove(int depth, int difficulty) {
-        ensureRandomInit();
-
-        try {
-            std::vector<Move> allMoves;
-            for (int r = 0; r < 8; r++) {
-                for (int c = 0; c < 8; c++) {
-                    if (board[r][c].color == currentPlayer) {
-                        std::vector<Move> moves = getLegalMoves(r, c);
-                        allMoves.insert(allMoves.end(), moves.begin(), moves.end());
-                    }
-                }
-            }
-
-            if (allMoves.empty()) {
-                return Move();
-            }
-
-            // Score and sort moves
-            for (Move& move : allMoves) {
-                move.score = scoreMoveOrdering(move);
-            }
-
-            std::sort(allMoves.begin(), allMoves.end(), [](const Move& a, const Move& b) {
-                return a.score > b.score;
-            });
-
-            Move bestMove = allMoves[0];
-            int bestScore = (currentPlayer == WHITE) ? std::numeric_limits<int>::min() : std::numeric_limits<int>::max();
-
-            for (Move& move : allMoves) {
-                // Save state
-                Piece temp = board[move.toRow][move.toCol];
-                Piece tempEnPassant;
-                int savedEnPassantCol = enPassantCol;
-                int savedEnPassantRow = enPassantRow;
-                Color prevPlayer = currentPlayer;
-                bool savedWhiteKing = whiteKingMoved, savedBlackKing = blackKingMoved;
-                bool savedWRA = whiteRookAMoved, savedWRH = whiteRookHMoved;
-                bool savedBRA = blackRookAMoved, savedBRH = blackRookHMoved;
-
-                if (move.isEnPassant) {
-                    int captureRow = (prevPlayer == WHITE) ? move.toRow + 1 : move.toRow - 1;
-                    tempEnPassant = board[captureRow][move.toCol];
-                }
-
-                executeMoveInternal(move, QUEEN);
-                int score = minimax(depth - 1, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), currentPlayer == BLACK);
-
-                // Restore state
-                currentPlayer = prevPlayer;
-                board[move.fromRow][move.fromCol] = board[move.toRow][move.toCol];
-                board[move.toRow][move.toCol] = temp;
-                enPassantCol = savedEnPassantCol;
-                enPassantRow = savedEnPassantRow;
-                whiteKingMoved = savedWhiteKing;
-                blackKingMoved = savedBlackKing;
-                whiteRookAMoved = savedWRA;
-                whiteRookHMoved = savedWRH;
-                blackRookAMoved = savedBRA;
-                blackRookHMoved = savedBRH;
-
-                if (move.isEnPassant) {
-                    int captureRow = (prevPlayer == WHITE) ? move.toRow + 1 : move.toRow - 1;
-                    board[captureRow][move.toCol] = tempEnPassant;
-                }
-
-                // Add randomness for lower difficulties
-                if (difficulty == 1) {
-                    score += g_random->getSmallNoise() * 20;
-                } else if (difficulty == 2) {
-                    score += g_random->getSmallNoise() * 10;
-                }
-
-                if ((prevPlayer == WHITE && (score > bestScore || (score == bestScore && g_random->getCoinFlip()))) ||
-                    (prevPlayer == BLACK && (score < bestScore || (score == bestScore && g_random->getCoinFlip())))) {
-                    bestScore = score;
-                    bestMove = move;
-                }
-            }
-
-            return bestMove;
-        } catch (const std::exception& e) {
-            LOGE("Exception in getBestMove: %s", e.what());
-            return Move();
-        } catch (...) {
-            LOGE("Unknown exception in getBestMove");
-            return Move();
-        }
-    }
+// Maps an opening book file; on failure the previous book stays
+extern "C" JNIEXPORT jboolean JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_loadBook(JNIEnv* env, jobject, jstring path) {
+    try {
+        const char* chars = env->GetStringUTFChars(path, nullptr);
+        if (!chars) return false;
+        std::string filePath(chars);
+        env->ReleaseStringUTFChars(path, chars);
 
-    int getCurrentPlayer() { 
-        return currentPlayer; 
-    }
+        std::shared_ptr<OpeningBook> loaded = std::make_shared<OpeningBook>();
+        if (!loaded->open(filePath)) return false;
 
-    bool isGameOver() {
-        for (int r = 0; r < 8; r++) {
-            for (int c = 0; c < 8; c++) {
-                if (board[r][c].color == currentPlayer) {
-                    if (!getLegalMoves(r, c).empty()) return false;
-                }
-            }
-        }
+        std::lock_guard<std::mutex> lock(resourceMutex);
+        book = std::move(loaded);
+        publishResources();
         return true;
+    } catch (const std::exception& e) {
+        LOGE("Exception in loadBook: %s", e.what());
+        return false;
+    } catch (...) {
+        LOGE("Unknown exception in loadBook");
+        return false;
     }
-};
-
-// Initialize static members
-const int ChessGame::pawnTableWhite[8][8] = {
-    {0,   0,   0,   0,   0,   0,   0,   0},
-    {50,  50,  50,  50,  50,  50,  50,  50},
-    {10,  10,  20,  30,  30,  20,  10,  10},
-    {5,   5,   10,  27,  27,  10,  5,   5},
-    {0,   0,   0,   25,  25,  0,   0,   0},
-    {5,   -5,  -10, 0,   0,   -10, -5,  5},
-    {5,   10,  10,  -25, -25, 10,  10,  5},
-    {0,   0,   0,   0,   0,   0,   0,   0}
-};
-
-const int ChessGame::knightTable[8][8] = {
-    {-50, -40, -30, -30, -30, -30, -40, -50},
-    {-40, -20, 0,   5,   5,   0,   -20, -40},
-    {-30, 5,   10,  15,  15,  10,  5,   -30},
-    {-30, 0,   15,  20,  20,  15,  0,   -30},
-    {-30, 5,   15,  20,  20,  15,  5,   -30},
-    {-30, 0,   10,  15,  15,  10,  0,   -30},
-    {-40, -20, 0,   0,   0,   0,   -20, -40},
-    {-50, -40, -20, -30, -30, -20, -40, -50}
-};
-
-const int ChessGame::bishopTable[8][8] = {
-    {-20, -10, -10, -10, -10, -10, -10, -20},
-    {-10, 5,   0,   0,   0,   0,   5,   -10},
-    {-10, 10,  10,  10,  10,  10,  10,  -10},
-    {-10, 0,   10,  10,  10,  10,  0,   -10},
-    {-10, 5,   5,   10,  10,  5,   5,   -10},
-    {-10, 0,   5,   10,  10,  5,   0,   -10},
-    {-10, 0,   0,   0,   0,   0,   0,   -10},
-    {-20, -10, -40, -10, -10, -40, -10, -20}
-};
-
-const int ChessGame::rookTable[8][8] = {
-    {0,  0,  0,  5,  5,  0,  0,  0},
-    {-5, 0,  0,  0,  0,  0,  0,  -5},
-    {-5, 0,  0,  0,  0,  0,  0,  -5},
-    {-5, 0,  0,  0,  0,  0,  0,  -5},
-    {-5, 0,  0,  0,  0,  0,  0,  -5},
-    {-5, 0,  0,  0,  0,  0,  0,  -5},
-    {5,  10, 10, 10, 10, 10, 10, 5},
-    {0,  0,  0,  0,  0,  0,  0,  0}
-};
-
-const int ChessGame::queenTable[8][8] = {
-    {-20, -10, -10, -5, -5, -10, -10, -20},
-    {-10, 0,   5,   0,  0,  0,   0,   -10},
-    {-10, 5,   5,   5,  5,  5,   0,   -10},
-    {0,   0,   5,   5,  5,  5,   0,   -5},
-    {-5,  0,   5,   5,  5,  5,   0,   -5},
-    {-10, 0,   5,   5,  5,  5,   0,   -10},
-    {-10, 0,   0,   0,  0,  0,   0,   -10},
-    {-20, -10, -10, -5, -5, -10, -10, -20}
-};
-
-const int ChessGame::kingTableMiddle[8][8] = {
-    {-30, -40, -40, -50, -50, -40, -40, -30},
-    {-30, -40, -40, -50, -50, -40, -40, -30},
-    {-30, -40, -40, -50, -50, -40, -40, -30},
-    {-30, -40, -40, -50, -50, -40, -40, -30},
-    {-20, -30, -30, -40, -40, -30, -30, -20},
-    {-10, -20, -20, -20, -20, -20, -20, -10},
-    {20,  20,  0,   0,   0,   0,   20,  20},
-    {20,  30,  10,  0,   0,   10,  30,  20}
-};
-
-const int ChessGame::kingTableEnd[8][8] = {
-    {-50, -30, -30, -30, -30, -30, -30, -50},
-    {-30, -30, 0,   0,   0,   0,   -30, -30},
-    {-30, -10, 20,  30,  30,  20,  -10, -30},
-    {-30, -10, 30,  40,  40,  30,  -10, -30},
-    {-30, -10, 30,  40,  40,  30,  -10, -30},
-    {-30, -10, 20,  30,  30,  20,  -10, -30},
-    {-30, -20, -10, 0,   0,   -10, -20, -30},
-    {-50, -40, -30, -20, -20, -30, -40, -50}
-};
-
-// Global game instance
-ChessGame* game = nullptr;
-int aiDifficulty = 2;
+}
 
-// JNI Functions
-extern "C" JNIEXPORT void JNICALL
-Java_elrasseo_syreao_checkmate_MainActivity_initGame(JNIEnv* env, jobject thiz) {
+// Endgame tables from the files in path, probed up to pieceLimit pieces;
+// false when there are none and the search goes without
+extern "C" JNIEXPORT jboolean JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_setTablebases(JNIEnv* env, jobject, jstring path, jint pieceLimit) {
     try {
-        LOGD("initGame called");
-
-        if (game) {
-            LOGD("Deleting existing game");
-            delete game;
-            game = nullptr;
-        }
-
-        LOGD("Creating new game");
-        game = new ChessGame();
-
-        if (game && game->isInitialized()) {
-            LOGD("Game initialized successfully");
-        } else {
-            LOGE("Game initialization failed");
-            if (game) {
-                delete game;
-                game = nullptr;
-            }
-        }
+        const char* chars = env->GetStringUTFChars(path, nullptr);
+        if (!chars) return false;
+        std::string directory(chars);
+        env->ReleaseStringUTFChars(path, chars);
+
+        std::shared_ptr<Tablebases> loaded = std::make_shared<Tablebases>();
+        loaded->setPath(directory);
+        loaded->setPieceLimit(pieceLimit);
+        if (loaded->getPieceLimit() == 0) loaded.reset();
+
+        // Searches still running keep probing the old tables until they end
+        std::lock_guard<std::mutex> lock(resourceMutex);
+        tablebases = std::move(loaded);
+        publishResources();
+        return tablebases != nullptr;
     } catch (const std::exception& e) {
-        LOGE("Exception in initGame: %s", e.what());
-        if (game) {
-            delete game;
-            game = nullptr;
-        }
+        LOGE("Exception in setTablebases: %s", e.what());
+        return false;
     } catch (...) {
-        LOGE("Unknown exception in initGame");
-        if (game) {
-            delete game;
-            game = nullptr;
-        }
+        LOGE("Unknown exception in setTablebases");
+        return false;
     }
 }
 
+// Chooses between the network and the piece-square tables
 extern "C" JNIEXPORT void JNICALL
-Java_elrasseo_syreao_checkmate_MainActivity_setDifficulty(JNIEnv* env, jobject, jint difficulty) {
+Java_elrasseo_syreao_checkmate_MainActivity_setUseNetwork(JNIEnv* env, jobject, jboolean enabled) {
     try {
-        aiDifficulty = difficulty;
-        LOGD("Difficulty set to %d", difficulty);
+        std::lock_guard<std::mutex> lock(resourceMutex);
+        useNetwork = enabled;
+        publishResources();
+        LOGD("Evaluation by %s", (useNetwork && network) ? "network" : "piece-square tables");
     } catch (...) {
-        LOGE("Exception in setDifficulty");
+        LOGE("Exception in setUseNetwork");
+    }
+}
+
+// Fills board with every square's getPiece code, row by row from a8, in
+// one call; returns the version of the position it copied
+extern "C" JNIEXPORT jint JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_getBoardSnapshot(JNIEnv* env, jobject, jintArray board) {
+    try {
+        if (!copyBoard(env, mainGame, board)) {
+            LOGE("Board array too short in getBoardSnapshot");
+            return -1;
+        }
+        return positionVersion();
+    } catch (...) {
+        LOGE("Exception in getBoardSnapshot");
+        return -1;
     }
 }
 
+extern "C" JNIEXPORT jint JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_getPositionVersion(JNIEnv* env, jobject) {
+    return positionVersion();
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_elrasseo_syreao_checkmate_MainActivity_getPiece(JNIEnv* env, jobject, jint row, jint col) {
     try {
-        if (!game) {
+        if (!mainGame) {
             LOGE("Game is null in getPiece");
             return 0;
         }
@@ -1078,7 +348,7 @@ Java_elrasseo_syreao_checkmate_MainActivity_getPiece(JNIEnv* env, jobject, jint
             LOGE("Invalid coordinates: %d, %d", row, col);
             return 0;
         }
-        return game->getPiece(row, col);
+        return mainGame->getGame().getPiece(row, col);
     } catch (const std::exception& e) {
         LOGE("Exception in getPiece: %s", e.what());
         return 0;
@@ -1091,7 +361,7 @@ Java_elrasseo_syreao_checkmate_MainActivity_getPiece(JNIEnv* env, jobject, jint
 extern "C" JNIEXPORT jintArray JNICALL
 Java_elrasseo_syreao_checkmate_MainActivity_getLegalMoves(JNIEnv* env, jobject, jint row, jint col) {
     try {
-        if (!game) {
+        if (!mainGame) {
             LOGE("Game is null in getLegalMoves");
             return env->NewIntArray(0);
         }
@@ -1100,26 +370,7 @@ Java_elrasseo_syreao_checkmate_MainActivity_getLegalMoves(JNIEnv* env, jobject,
             LOGE("Invalid coordinates in getLegalMoves: %d, %d", row, col);
             return env->NewIntArray(0);
         }
-
-        std::vector<Move> moves = game->getLegalMoves(row, col);
-        jintArray result = env->NewIntArray(moves.size() * 2);
-
-        if (result == nullptr) {
-            LOGE("Failed to create int array");
-            return env->NewIntArray(0);
-        }
-
-        std::vector<jint> positions;
-        for (const Move& move : moves) {
-            positions.push_back(move.toRow);
-            positions.push_back(move.toCol);
-        }
-
-        if (!positions.empty()) {
-            env->SetIntArrayRegion(result, 0, positions.size(), positions.data());
-        }
-
-        return result;
+        return legalMovesFrom(env, *mainGame, row, col);
     } catch (const std::exception& e) {
         LOGE("Exception in getLegalMoves: %s", e.what());
         return env->NewIntArray(0);
@@ -1129,14 +380,29 @@ Java_elrasseo_syreao_checkmate_MainActivity_getLegalMoves(JNIEnv* env, jobject,
     }
 }
 
+// Every legal move of the position as from * 64 + to, squares numbered
+// row * 8 + col; promotions appear once, as the queen's
+extern "C" JNIEXPORT jintArray JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_getAllLegalMoves(JNIEnv* env, jobject) {
+    try {
+        return allLegalMoves(env, mainGame);
+    } catch (const std::exception& e) {
+        LOGE("Exception in getAllLegalMoves: %s", e.what());
+        return nullptr;
+    } catch (...) {
+        LOGE("Unknown exception in getAllLegalMoves");
+        return nullptr;
+    }
+}
+
 extern "C" JNIEXPORT jboolean JNICALL
 Java_elrasseo_syreao_checkmate_MainActivity_makeMove(JNIEnv* env, jobject, jint fromRow, jint fromCol, jint toRow, jint toCol) {
     try {
-        if (!game) {
+        if (!mainGame) {
             LOGE("Game is null in makeMove");
             return false;
         }
-        return game->makeMove(fromRow, fromCol, toRow, toCol);
+        return mainGame->makeMove(fromRow, fromCol, toRow, toCol);
     } catch (const std::exception& e) {
         LOGE("Exception in makeMove: %s", e.what());
         return false;
@@ -1146,45 +412,112 @@ Java_elrasseo_syreao_checkmate_MainActivity_makeMove(JNIEnv* env, jobject, jint
     }
 }
 
+// Blocking search; startSearch and pollComputerMove keep the UI responsive
 extern "C" JNIEXPORT jintArray JNICALL
 Java_elrasseo_syreao_checkmate_MainActivity_getComputerMove(JNIEnv* env, jobject) {
     try {
-        if (!game) {
+        if (!mainGame) {
             LOGE("Game is null in getComputerMove");
-            jintArray result = env->NewIntArray(4);
-            jint moveData[4] = {-1, -1, -1, -1};
-            env->SetIntArrayRegion(result, 0, 4, moveData);
-            return result;
+            return moveToArray(env, Move::none());
         }
-
-        int depth = aiDifficulty + 1;
-        if (aiDifficulty == 4) depth = 5;
-
-        Move bestMove = game->getBestMove(depth, aiDifficulty);
-        jintArray result = env->NewIntArray(4);
-        jint moveData[4] = {bestMove.fromRow, bestMove.fromCol, bestMove.toRow, bestMove.toCol};
-        env->SetIntArrayRegion(result, 0, 4, moveData);
-        return result;
+        return moveToArray(env, mainGame->searchMove());
     } catch (const std::exception& e) {
         LOGE("Exception in getComputerMove: %s", e.what());
-        jintArray result = env->NewIntArray(4);
-        jint moveData[4] = {-1, -1, -1, -1};
-        env->SetIntArrayRegion(result, 0, 4, moveData);
-        return result;
+        return moveToArray(env, Move::none());
     } catch (...) {
         LOGE("Unknown exception in getComputerMove");
-        jintArray result = env->NewIntArray(4);
-        jint moveData[4] = {-1, -1, -1, -1};
-        env->SetIntArrayRegion(result, 0, 4, moveData);
-        return result;
+        return moveToArray(env, Move::none());
+    }
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_startSearch(JNIEnv* env, jobject) {
+    try {
+        if (!mainGame) {
+            LOGE("Game is null in startSearch");
+            return false;
+        }
+        mainGame->startSearch();
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("Exception in startSearch: %s", e.what());
+        return false;
+    } catch (...) {
+        LOGE("Unknown exception in startSearch");
+        return false;
+    }
+}
+
+// Searches the expected reply while the player thinks; false when there
+// is no guess to ponder on
+extern "C" JNIEXPORT jboolean JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_startPondering(JNIEnv* env, jobject) {
+    try {
+        if (!mainGame) {
+            LOGE("Game is null in startPondering");
+            return false;
+        }
+        return mainGame->startPondering();
+    } catch (const std::exception& e) {
+        LOGE("Exception in startPondering: %s", e.what());
+        return false;
+    } catch (...) {
+        LOGE("Unknown exception in startPondering");
+        return false;
+    }
+}
+
+// Ends a ponder search the player has not answered yet
+extern "C" JNIEXPORT void JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_stopPondering(JNIEnv* env, jobject) {
+    try {
+        if (mainGame) mainGame->stopPondering();
+    } catch (...) {
+        LOGE("Exception in stopPondering");
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_stopSearch(JNIEnv* env, jobject) {
+    try {
+        if (mainGame) mainGame->stopSearch();
+    } catch (...) {
+        LOGE("Exception in stopSearch");
+    }
+}
+
+// The finished search's move, or null while it is still running
+extern "C" JNIEXPORT jintArray JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_pollComputerMove(JNIEnv* env, jobject) {
+    try {
+        if (!mainGame) return moveToArray(env, Move::none());
+        return polledMove(env, *mainGame);
+    } catch (const std::exception& e) {
+        LOGE("Exception in pollComputerMove: %s", e.what());
+        return nullptr;
+    } catch (...) {
+        LOGE("Unknown exception in pollComputerMove");
+        return nullptr;
+    }
+}
+
+// Depth, nodes, speed and main line of the running or last search; may be
+// called while polling to follow it iteration by iteration
+extern "C" JNIEXPORT jstring JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_getSearchInfo(JNIEnv* env, jobject) {
+    try {
+        return searchInfo(env, mainGame);
+    } catch (...) {
+        LOGE("Exception in getSearchInfo");
+        return nullptr;
     }
 }
 
 extern "C" JNIEXPORT jint JNICALL
 Java_elrasseo_syreao_checkmate_MainActivity_getCurrentPlayer(JNIEnv* env, jobject) {
     try {
-        if (!game) return 1;
-        return game->getCurrentPlayer();
+        if (!mainGame) return 1;
+        return mainGame->getGame().getCurrentPlayer();
     } catch (...) {
         LOGE("Exception in getCurrentPlayer");
         return 1;
@@ -1194,30 +527,284 @@ Java_elrasseo_syreao_checkmate_MainActivity_getCurrentPlayer(JNIEnv* env, jobjec
 extern "C" JNIEXPORT jboolean JNICALL
 Java_elrasseo_syreao_checkmate_MainActivity_isGameOver(JNIEnv* env, jobject) {
     try {
-        if (!game) return false;
-        return game->isGameOver();
+        if (!mainGame) return false;
+        return mainGame->legalMoves().empty();
     } catch (...) {
         LOGE("Exception in isGameOver");
         return false;
     }
 }
 
+// GAME_ONGOING, or how the side to move has run out of moves
+extern "C" JNIEXPORT jint JNICALL
+Java_elrasseo_syreao_checkmate_MainActivity_getGameStatus(JNIEnv* env, jobject) {
+    try {
+        if (!mainGame) return GAME_ONGOING;
+        return mainGame->getStatus();
+    } catch (...) {
+        LOGE("Exception in getGameStatus");
+        return GAME_ONGOING;
+    }
+}
+
+// Releases the main game, ending its search. Games created through
+// NativeEngine are left as they are; the shared data stays loaded for
+// them, and drops away with the last game using it once it is replaced.
 extern "C" JNIEXPORT void JNICALL
 Java_elrasseo_syreao_checkmate_MainActivity_cleanupGame(JNIEnv* env, jobject thiz) {
     try {
         LOGD("cleanupGame called");
-        if (game) {
-            delete game;
-            game = nullptr;
+        if (mainGame) {
+            versionBase = positionVersion() + 1;
+            delete mainGame;
+            mainGame = nullptr;
             LOGD("Game cleaned up successfully");
         }
-        if (g_random) {
-            delete g_random;
-            g_random = nullptr;
-        }
     } catch (const std::exception& e) {
         LOGE("Exception in cleanupGame: %s", e.what());
     } catch (...) {
         LOGE("Unknown exception in cleanupGame");
     }
 }
+
+// NativeEngine: any number of games, each named by the handle createGame
+// returns and safe to drive from its own thread. A handle that was
+// destroyed or never issued is ignored, as calls without a game are above.
+
+// A game in the start position, zero when no more can be hosted
+extern "C" JNIEXPORT jlong JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_createGame(JNIEnv* env, jclass) {
+    try {
+        return static_cast<jlong>(pool()->create());
+    } catch (const std::exception& e) {
+        LOGE("Exception in createGame: %s", e.what());
+        return 0;
+    } catch (...) {
+        LOGE("Unknown exception in createGame");
+        return 0;
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_destroyGame(JNIEnv* env, jclass, jlong handle) {
+    try {
+        pool()->release(static_cast<uint64_t>(handle));
+    } catch (...) {
+        LOGE("Exception in destroyGame");
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_newGame(JNIEnv* env, jclass, jlong handle) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        if (GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock)) instance->newGame();
+    } catch (...) {
+        LOGE("Exception in newGame");
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_setDifficulty(JNIEnv* env, jclass, jlong handle, jint difficulty) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        if (GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock)) {
+            instance->setDifficulty(difficulty);
+        }
+    } catch (...) {
+        LOGE("Exception in setDifficulty");
+    }
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_makeMove(JNIEnv* env, jclass, jlong handle, jint fromRow, jint fromCol, jint toRow, jint toCol) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock);
+        return instance && instance->makeMove(fromRow, fromCol, toRow, toCol);
+    } catch (const std::exception& e) {
+        LOGE("Exception in makeMove: %s", e.what());
+        return false;
+    } catch (...) {
+        LOGE("Unknown exception in makeMove");
+        return false;
+    }
+}
+
+// As MainActivity.getBoardSnapshot, for one game; -1 for a stale handle
+extern "C" JNIEXPORT jint JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_getBoardSnapshot(JNIEnv* env, jclass, jlong handle, jintArray board) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock);
+        if (!instance || !copyBoard(env, instance, board)) return -1;
+        return static_cast<jint>(instance->getVersion());
+    } catch (...) {
+        LOGE("Exception in getBoardSnapshot");
+        return -1;
+    }
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_getPositionVersion(JNIEnv* env, jclass, jlong handle) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock);
+        return instance ? static_cast<jint>(instance->getVersion()) : -1;
+    } catch (...) {
+        LOGE("Exception in getPositionVersion");
+        return -1;
+    }
+}
+
+extern "C" JNIEXPORT jintArray JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_getLegalMoves(JNIEnv* env, jclass, jlong handle, jint row, jint col) {
+    try {
+        if (row < 0 || row >= 8 || col < 0 || col >= 8) {
+            LOGE("Invalid coordinates in getLegalMoves: %d, %d", row, col);
+            return env->NewIntArray(0);
+        }
+        std::unique_lock<std::mutex> lock;
+        GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock);
+        if (!instance) return env->NewIntArray(0);
+        return legalMovesFrom(env, *instance, row, col);
+    } catch (...) {
+        LOGE("Exception in getLegalMoves");
+        return env->NewIntArray(0);
+    }
+}
+
+extern "C" JNIEXPORT jintArray JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_getAllLegalMoves(JNIEnv* env, jclass, jlong handle) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        return allLegalMoves(env, pool()->lock(static_cast<uint64_t>(handle), lock));
+    } catch (...) {
+        LOGE("Exception in getAllLegalMoves");
+        return nullptr;
+    }
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_getGameStatus(JNIEnv* env, jclass, jlong handle) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock);
+        return instance ? instance->getStatus() : GAME_ONGOING;
+    } catch (...) {
+        LOGE("Exception in getGameStatus");
+        return GAME_ONGOING;
+    }
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_getCurrentPlayer(JNIEnv* env, jclass, jlong handle) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock);
+        return instance ? instance->getGame().getCurrentPlayer() : 1;
+    } catch (...) {
+        LOGE("Exception in getCurrentPlayer");
+        return 1;
+    }
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_startSearch(JNIEnv* env, jclass, jlong handle) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock);
+        if (!instance) return false;
+        instance->startSearch();
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("Exception in startSearch: %s", e.what());
+        return false;
+    } catch (...) {
+        LOGE("Unknown exception in startSearch");
+        return false;
+    }
+}
+
+extern "C" JNIEXPORT jintArray JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_pollComputerMove(JNIEnv* env, jclass, jlong handle) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock);
+        if (!instance) return moveToArray(env, Move::none());
+        return polledMove(env, *instance);
+    } catch (...) {
+        LOGE("Exception in pollComputerMove");
+        return nullptr;
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_stopSearch(JNIEnv* env, jclass, jlong handle) {
+    try {
+        pool()->stopSearch(static_cast<uint64_t>(handle));
+    } catch (...) {
+        LOGE("Exception in stopSearch");
+    }
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_getSearchInfo(JNIEnv* env, jclass, jlong handle) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        return searchInfo(env, pool()->lock(static_cast<uint64_t>(handle), lock));
+    } catch (...) {
+        LOGE("Exception in getSearchInfo");
+        return nullptr;
+    }
+}
+
+// Blocking search. The game stays locked until the move is found; other
+// calls on it wait, except stopSearch, which ends it early.
+extern "C" JNIEXPORT jintArray JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_getComputerMove(JNIEnv* env, jclass, jlong handle) {
+    try {
+        std::unique_lock<std::mutex> lock;
+        GameInstance* instance = pool()->lock(static_cast<uint64_t>(handle), lock);
+        if (!instance) return moveToArray(env, Move::none());
+        return moveToArray(env, instance->searchMove());
+    } catch (const std::exception& e) {
+        LOGE("Exception in getComputerMove: %s", e.what());
+        return moveToArray(env, Move::none());
+    } catch (...) {
+        LOGE("Unknown exception in getComputerMove");
+        return moveToArray(env, Move::none());
+    }
+}
+
+// The search benchmark, as the host bench tool runs it: one line with the
+// positions, depth, nodes, time, speed and signature. Blocks for seconds;
+// the loaded network, if asked for and present, is kept alive meanwhile.
+extern "C" JNIEXPORT jstring JNICALL
+Java_elrasseo_syreao_checkmate_NativeEngine_bench(JNIEnv* env, jclass, jint depth, jboolean withNetwork) {
+    try {
+        int benchDepth = depth > 0 ? depth : DEFAULT_BENCH_DEPTH;
+        std::shared_ptr<const NnueNetwork> benchNetwork;
+        if (withNetwork) {
+            std::lock_guard<std::mutex> lock(resourceMutex);
+            benchNetwork = network;
+        }
+        BenchResult result = runBench(benchDepth, benchNetwork.get());
+
+        std::string line = "positions " + std::to_string(result.positions) + " depth " +
+                           std::to_string(benchDepth) + " nodes " + std::to_string(result.nodes) + " time " +
+                           std::to_string(result.timeMs) + " nps " + std::to_string(result.nodesPerSecond()) +
+                           " signature " + std::to_string(result.nodes);
+        if (result.invalidPositions > 0) {
+            line += " invalid " + std::to_string(result.invalidPositions);
+        }
+        LOGD("bench %s", line.c_str());
+        return env->NewStringUTF(line.c_str());
+    } catch (const std::exception& e) {
+        LOGE("Exception in bench: %s", e.what());
+        return nullptr;
+    } catch (...) {
+        LOGE("Unknown exception in bench");
+        return nullptr;
+    }
+}
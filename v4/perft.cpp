@@ -0,0 +1,195 @@
+// Move generator benchmark and self-test. Counts the leaf nodes of the
+// legal move tree to a fixed depth and compares them with published
+// reference counts.
+//
+//   perft                      run the reference suite
+//   perft --fen FEN --depth N  count one position
+//
+// Options: --divide prints the count below each root move, --threads N
+// splits the root moves over N threads and --no-bulk plays out the last
+// ply instead of counting generated moves.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "engine/chess_game.h"
+
+namespace {
+
+struct PerftCase {
+    const char* name;
+    const char* fen;
+    int depth;
+    uint64_t nodes[6];
+};
+
+// Reference counts by depth, from depth 1
+const PerftCase perftSuite[] = {
+    {"startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6,
+     {20, 400, 8902, 197281, 4865609, 119060324}},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5,
+     {48, 2039, 97862, 4085603, 193690690, 8031647685ULL}},
+    {"position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6,
+     {14, 191, 2812, 43238, 674624, 11030083}},
+    {"position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5,
+     {6, 264, 9467, 422333, 15833292, 706045033}},
+    {"position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5,
+     {44, 1486, 62379, 2103487, 89941194, 0}},
+    {"position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5,
+     {46, 2079, 89890, 3894594, 164075551, 6923051137ULL}},
+};
+
+struct PerftOptions {
+    int threads = 1;
+    bool divide = false;
+    bool bulk = true;
+};
+
+uint64_t perft(ChessGame& game, int depth, bool bulk) {
+    MoveList moves;
+    game.generateLegalMoves(moves);
+    if (depth == 1 && bulk) return moves.size();
+
+    uint64_t nodes = 0;
+    for (const Move& move : moves) {
+        if (depth == 1) {
+            nodes++;
+            continue;
+        }
+        game.makeMove(move);
+        nodes += perft(game, depth - 1, bulk);
+        game.unmakeMove();
+    }
+    return nodes;
+}
+
+// Searches the root moves on a pool of threads, each on its own copy of
+// the position, and returns the total
+uint64_t perftRoot(const ChessGame& root, int depth, const PerftOptions& options) {
+    MoveList rootMoves;
+    ChessGame(root).generateLegalMoves(rootMoves);
+    if (depth <= 0) return 1;
+
+    std::vector<uint64_t> counts(rootMoves.size(), 0);
+    std::atomic<int> nextMove(0);
+
+    auto worker = [&]() {
+        ChessGame game(root);
+        for (int i = nextMove++; i < rootMoves.size(); i = nextMove++) {
+            if (depth == 1) {
+                counts[i] = 1;
+                continue;
+            }
+            game.makeMove(rootMoves[i]);
+            counts[i] = perft(game, depth - 1, options.bulk);
+            game.unmakeMove();
+        }
+    };
+
+    int threadCount = std::max(1, std::min(options.threads, rootMoves.size()));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threadCount; t++) pool.emplace_back(worker);
+    worker();
+    for (std::thread& thread : pool) thread.join();
+
+    uint64_t total = 0;
+    for (int i = 0; i < rootMoves.size(); i++) {
+        if (options.divide) {
+            std::printf("%s: %llu\n", moveToString(rootMoves[i]).c_str(),
+                        static_cast<unsigned long long>(counts[i]));
+        }
+        total += counts[i];
+    }
+    return total;
+}
+
+// Runs one position and prints nodes, time and speed
+uint64_t runPerft(const ChessGame& game, int depth, const PerftOptions& options, const char* label) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = perftRoot(game, depth, options);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double nps = seconds > 0 ? nodes / seconds : 0;
+
+    std::printf("%-10s depth %d  nodes %12llu  time %8.3fs  nps %12.0f\n", label, depth,
+                static_cast<unsigned long long>(nodes), seconds, nps);
+    return nodes;
+}
+
+int runSuite(int depthOffset, const PerftOptions& options) {
+    int failures = 0;
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const PerftCase& test : perftSuite) {
+        int depth = std::max(1, std::min(test.depth + depthOffset, 6));
+        uint64_t expected = test.nodes[depth - 1];
+
+        ChessGame game;
+        game.setFromFen(test.fen);
+        uint64_t nodes = runPerft(game, depth, options, test.name);
+        totalNodes += nodes;
+
+        if (expected != 0 && nodes != expected) {
+            std::printf("  FAILED: expected %llu\n", static_cast<unsigned long long>(expected));
+            failures++;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("total      nodes %llu  time %.3fs  nps %.0f\n",
+                static_cast<unsigned long long>(totalNodes), seconds, seconds > 0 ? totalNodes / seconds : 0);
+    std::printf("%s\n", failures ? "perft suite FAILED" : "perft suite passed");
+    return failures ? 1 : 0;
+}
+
+void printUsage() {
+    std::printf("usage: perft [--fen FEN] [--depth N] [--depth-offset N] [--threads N]\n"
+                "             [--divide] [--no-bulk]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    PerftOptions options;
+    std::string fen;
+    int depth = 0;
+    int depthOffset = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--fen" && hasValue) {
+            fen = argv[++i];
+        } else if (arg == "--depth" && hasValue) {
+            depth = std::atoi(argv[++i]);
+        } else if (arg == "--depth-offset" && hasValue) {
+            depthOffset = std::atoi(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--divide") {
+            options.divide = true;
+        } else if (arg == "--no-bulk") {
+            options.bulk = false;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    if (fen.empty() && depth == 0) {
+        return runSuite(depthOffset, options);
+    }
+
+    ChessGame game;
+    if (!fen.empty() && !game.setFromFen(fen)) {
+        std::fprintf(stderr, "invalid FEN: %s\n", fen.c_str());
+        return 2;
+    }
+    runPerft(game, depth > 0 ? depth : 5, options, "position");
+    return 0;
+}